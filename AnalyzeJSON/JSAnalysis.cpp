@@ -9,6 +9,104 @@
 #include "JSAnalysis.h"
 #include "JSUtils.h"
 #import <unordered_set>
+#include <algorithm>
+
+/************************************************************************/
+/*																		*/
+/*	JSDeclRange															*/
+/*																		*/
+/************************************************************************/
+
+void JSDeclRange::clear()
+{
+	hasNumber = false;
+	width = DECLWIDTH_NONE;
+	minNumber = 0;
+	maxNumber = 0;
+	minInteger = INT64_MAX;
+	maxInteger = INT64_MIN;
+
+	hasString = false;
+	minLength = 0;
+	maxLength = 0;
+	values.clear();
+}
+
+void JSDeclRange::addNumber(const JSNumber &value)
+{
+	if (!hasNumber) {
+		hasNumber = true;
+		minNumber = value.real;
+		maxNumber = value.real;
+	} else {
+		if (minNumber > value.real) minNumber = value.real;
+		if (maxNumber < value.real) maxNumber = value.real;
+	}
+
+	int32_t w = DECLWIDTH_NONE;
+	if (value.type == JSNUMBER_INTEGER) {
+		if (minInteger > value.integer) minInteger = value.integer;
+		if (maxInteger < value.integer) maxInteger = value.integer;
+		w = ((value.integer >= INT32_MIN) && (value.integer <= INT32_MAX)) ? DECLWIDTH_INT32 : DECLWIDTH_INT64;
+	} else if (value.type == JSNUMBER_UNSIGNED) {
+		w = DECLWIDTH_UINT64;
+	} else if (value.type == JSNUMBER_BIGINTEGER) {
+		w = DECLWIDTH_BIG;
+	}
+	if (width < w) width = w;
+}
+
+void JSDeclRange::addString(const char *str, size_t length)
+{
+	/*
+	 *	Count characters, not the bytes of their UTF-8 encoding
+	 */
+
+	uint32_t chars = 0;
+	for (size_t i = 0; i < length; ++i) {
+		if ((str[i] & 0xC0) != 0x80) ++chars;
+	}
+
+	if (!hasString) {
+		hasString = true;
+		minLength = chars;
+		maxLength = chars;
+	} else {
+		if (minLength > chars) minLength = chars;
+		if (maxLength < chars) maxLength = chars;
+	}
+
+	values.add(str,length);
+}
+
+void JSDeclRange::merge(const JSDeclRange &range)
+{
+	if (range.hasNumber) {
+		if (!hasNumber) {
+			hasNumber = true;
+			minNumber = range.minNumber;
+			maxNumber = range.maxNumber;
+		} else {
+			if (minNumber > range.minNumber) minNumber = range.minNumber;
+			if (maxNumber < range.maxNumber) maxNumber = range.maxNumber;
+		}
+		if (minInteger > range.minInteger) minInteger = range.minInteger;
+		if (maxInteger < range.maxInteger) maxInteger = range.maxInteger;
+		if (width < range.width) width = range.width;
+	}
+
+	if (range.hasString) {
+		if (!hasString) {
+			hasString = true;
+			minLength = range.minLength;
+			maxLength = range.maxLength;
+		} else {
+			if (minLength > range.minLength) minLength = range.minLength;
+			if (maxLength < range.maxLength) maxLength = range.maxLength;
+		}
+		values.merge(range.values);
+	}
+}
 
 /************************************************************************/
 /*																		*/
@@ -22,6 +120,7 @@ JSDeclTemplate::JSDeclTemplate(ref<JSDeclTemplate> ref, const std::string &n)
 	isNullable = ref->isNullable;
 	isOptional = ref->isOptional;
 	isReal = ref->isReal;
+	range = ref->range;
 	name = n;
 	arrayType = ref->arrayType;
 	object = ref->object;
@@ -31,6 +130,7 @@ JSDeclTemplate::JSDeclTemplate(ref<JSDeclTemplate> ref, const std::string &n)
 JSDeclTemplate::JSDeclTemplate(ref<JSONValue> val)
 {
 	isOptional = false;
+	isReal = false;
 
 	if (val->getJSONType() == JSONTYPE_NULL) {
 		declType = JSONTYPE_UNDEFINED;
@@ -73,31 +173,186 @@ JSDeclTemplate::JSDeclTemplate(ref<JSONValue> val)
 			 */
 
 			JSONObject *o = (JSONObject *)val.get();
-			std::map<std::string,ref<JSONValue> >::iterator it;
+			JSONObject::iterator it;
 			for (it = o->begin(); it != o->end(); ++it) {
 				ref<JSDeclTemplate> type = new JSDeclTemplate(it->second);
-				object[it->first] = type;
+				object[JSInternSymbol(it->first)] = type;
 			}
 
 		} else if (declType == JSONTYPE_NUMBER) {
 			JSONNumber *number = (JSONNumber *)val.get();
 
 			isReal = !number->isInteger();
+			range.addNumber(number->getValue());
+
+		} else if (declType == JSONTYPE_STRING) {
+			JSONString *str = (JSONString *)val.get();
+
+			range.addString(str->data(),str->length());
+		}
+	}
+}
+
+/*	JSDeclTemplate::JSDeclTemplate
+ *
+ *		Build the template from a value parsed into an arena. This follows
+ *	the JSONValue constructor above; duplicate keys resolve to the last
+ *	value, as they do in JSONObject
+ */
+
+JSDeclTemplate::JSDeclTemplate(const JSArenaValue *val)
+{
+	isOptional = false;
+	isReal = false;
+
+	if (val->type == JSONTYPE_NULL) {
+		declType = JSONTYPE_UNDEFINED;
+		isNullable = true;
+
+	} else {
+		declType = val->type;
+		isNullable = false;
+
+		if (declType == JSONTYPE_ARRAY) {
+			if (val->length == 0) {
+				arrayType = new JSDeclTemplate;
+			} else {
+				arrayType = NULL;
+				for (uint32_t i = 0; i < val->length; ++i) {
+					ref<JSDeclTemplate> tmp = new JSDeclTemplate(val->array + i);
+					if (arrayType == NULL) {
+						arrayType = tmp;
+					} else {
+						arrayType->merge(tmp);
+					}
+				}
+			}
+		} else if (declType == JSONTYPE_OBJECT) {
+			for (uint32_t i = 0; i < val->length; ++i) {
+				const JSArenaMember *m = val->object + i;
+				object[JSInternSymbol(m->key,m->keyLength)] = new JSDeclTemplate(&m->value);
+			}
+
+		} else if (declType == JSONTYPE_NUMBER) {
+			JSNumber number;
+			JSParseNumber(val->string,val->length,&number);
+
+			isReal = !number.isInteger();
+			range.addNumber(number);
+
+		} else if (declType == JSONTYPE_STRING) {
+			range.addString(val->string,val->length);
+		}
+	}
+}
+
+/*	JSDeclTemplate::JSDeclTemplate
+ *
+ *		Build the template from the value at the given index on a tape.
+ *	The contents of containers follow the start entry, so this walks the
+ *	tape forward from index
+ */
+
+JSDeclTemplate::JSDeclTemplate(const JSTape *tape, size_t index)
+{
+	uint8_t type = tape->getType(index);
+
+	isOptional = false;
+	isReal = false;
+	isNullable = false;
+
+	switch (type) {
+		case TAPE_NULL:
+			declType = JSONTYPE_UNDEFINED;
+			isNullable = true;
+			break;
+
+		case TAPE_TRUE:
+		case TAPE_FALSE:
+			declType = JSONTYPE_BOOLEAN;
+			break;
+
+		case TAPE_STRING: {
+			uint32_t len;
+			const char *str = tape->getString(index,&len);
+
+			declType = JSONTYPE_STRING;
+			range.addString(str,len);
+			break;
+		}
+
+		case TAPE_NUMBER: {
+			uint32_t len;
+			const char *str = tape->getString(index,&len);
+			JSNumber number;
+			JSParseNumber(str,len,&number);
+
+			declType = JSONTYPE_NUMBER;
+			isReal = !number.isInteger();
+			range.addNumber(number);
+			break;
+		}
+
+		case TAPE_ARRAY_START: {
+			size_t end = (size_t)tape->getPayload(index);
+
+			declType = JSONTYPE_ARRAY;
+			arrayType = NULL;
+			for (size_t i = index + 1; i < end; i = tape->next(i)) {
+				ref<JSDeclTemplate> tmp = new JSDeclTemplate(tape,i);
+				if (arrayType == NULL) {
+					arrayType = tmp;
+				} else {
+					arrayType->merge(tmp);
+				}
+			}
+			if (arrayType == NULL) arrayType = new JSDeclTemplate;
+			break;
+		}
+
+		case TAPE_OBJECT_START: {
+			size_t end = (size_t)tape->getPayload(index);
+
+			declType = JSONTYPE_OBJECT;
+			for (size_t i = index + 1; i < end; i = tape->next(i + 1)) {
+				uint32_t len;
+				const char *key = tape->getString(i,&len);
+				object[JSInternSymbol(key,len)] = new JSDeclTemplate(tape,i + 1);
+			}
+			break;
 		}
 	}
 }
 
-void JSDeclTemplate::merge(ref<JSDeclTemplate> type)
+/*	JSDeclTemplate::merge
+ *
+ *		Merge another template into this one. Returns true if this changed
+ *	the declaration: its type, flags or fields. Widening the ranges, or
+ *	adding to the types found for an illegal type, does not count.
+ *
+ *		The mode is a DECLMERGE constant. Merging into a declaration uses
+ *	DECLMERGE_OWN: the templates of the objects within it can be shared
+ *	with their own declarations, so merging their ranges here as well
+ *	would count those values twice.
+ */
+
+bool JSDeclTemplate::merge(ref<JSDeclTemplate> type, int mode)
 {
+	bool changed = (type->isNullable && !isNullable) ||
+			(type->isOptional && !isOptional) ||
+			(type->isReal && !isReal);
+
 	isNullable |= type->isNullable;
 	isOptional |= type->isOptional;
 	isReal |= type->isReal;
+	if (mode != DECLMERGE_NONE) range.merge(type->range);
 
 	if (declType == JSONTYPE_UNDEFINED) {
 		/*
 		 *	Undefined; bring in type source
 		 */
 
+		if (type->declType != JSONTYPE_UNDEFINED) changed = true;
 		declType = type->declType;
 		arrayType = type->arrayType;
 		object = type->object;
@@ -127,9 +382,12 @@ void JSDeclTemplate::merge(ref<JSDeclTemplate> type)
 		 *	Types don't match; declaration type
 		 */
 
+		changed = true;
+
 		ref<JSDeclTemplate> copy = new JSDeclTemplate;
 		copy->declType = declType;
 		copy->isNullable = isNullable;
+		copy->range = range;
 		copy->arrayType = arrayType;
 		copy->object = object;
 		copy->illegalList = illegalList;
@@ -152,44 +410,65 @@ void JSDeclTemplate::merge(ref<JSDeclTemplate> type)
 
 		if (declType == JSONTYPE_ARRAY) {
 			/* Merge array types */
-			arrayType->merge(type->arrayType);
+			changed |= arrayType->merge(type->arrayType,mode);
 
 		} else if (declType == JSONTYPE_OBJECT) {
-			/* Merge objects */
-			std::unordered_set<std::string> fields;
-			std::map<std::string, ref<JSDeclTemplate> >::iterator it;
-
-			/* Step 1: insert from the first side */
-			for (it = object.begin(); it != object.end(); ++it) {
-				fields.insert(it->first);
-			}
-
-			/* Step 2: Merge the fields, and note those which are not on both sides */
-			for (it = type->object.begin(); it != type->object.end(); ++it) {
-				/* Fields: remove if already there, add if not. */
-				if (fields.count(it->first) == 0) {
-					fields.insert(it->first);
-				} else {
-					fields.erase(it->first);
-				}
-
-				/* Now merge the types */
-				ref<JSDeclTemplate> &srcRef = object[it->first];
-				if (srcRef == NULL) {
-					srcRef = it->second;
+			/* Merge objects. Both maps are sorted by key, so this walks
+			 * them side by side */
+			std::vector<JSDeclTemplate *> optional;
+			FieldMap::iterator a = object.begin();
+			FieldMap::iterator b = type->object.begin();
+
+			/* Step 1: merge the fields on both sides, and bring in those
+			 * only on the other side. Note those which are not on both */
+			while (b != type->object.end()) {
+				if ((a == object.end()) || (b->first < a->first)) {
+					object.insert(a,*b);
+					optional.push_back(b->second);
+					changed = true;
+					++b;
+				} else if (a->first < b->first) {
+					optional.push_back(a->second);
+					++a;
 				} else {
-					srcRef->merge(it->second);
+					int fieldMode = mode;
+					if ((mode == DECLMERGE_OWN) && (a->second->holdsObject() || b->second->holdsObject())) {
+						fieldMode = DECLMERGE_NONE;
+					}
+					changed |= a->second->merge(b->second,fieldMode);
+					++a;
+					++b;
 				}
 			}
+			while (a != object.end()) {
+				optional.push_back(a->second);
+				++a;
+			}
 
-			/* Step 3: mark all fields that are not in common as optional */
-			std::unordered_set<std::string>::iterator fiter;
-			for (fiter = fields.begin(); fiter != fields.end(); ++fiter) {
-				ref<JSDeclTemplate> ref = object[*fiter];
-				ref->isOptional = true;
+			/* Step 2: mark all fields that are not in common as optional */
+			std::vector<JSDeclTemplate *>::iterator fiter;
+			for (fiter = optional.begin(); fiter != optional.end(); ++fiter) {
+				if (!(*fiter)->isOptional) changed = true;
+				(*fiter)->isOptional = true;
 			}
 		}
 	}
+
+	return changed;
+}
+
+/*	JSDeclTemplate::holdsObject
+ *
+ *		True if this is an object, or an array of them
+ */
+
+bool JSDeclTemplate::holdsObject()
+{
+	JSDeclTemplate *templ = this;
+	while (templ->declType == JSONTYPE_ARRAY) {
+		templ = templ->arrayType;
+	}
+	return templ->declType == JSONTYPE_OBJECT;
 }
 
 /*
@@ -224,30 +503,21 @@ bool JSDeclTemplate::isCompatible(ref<JSDeclTemplate> type)
 
 	if (declType == JSONTYPE_OBJECT) {
 		/*
-		 *	First, build a list of all the objects, and fail if the
-		 *	object keys are not the same
+		 *	Fail if the object keys are not the same, or if any of the
+		 *	fields are incompatible. Both maps are sorted by key, so this
+		 *	is one walk over the two of them
 		 */
 
-		std::map<std::string, ref<JSDeclTemplate> >::iterator it;
-		std::unordered_set<std::string> fields;
+		if (object.size() != type->object.size()) return false;
 
-		for (it = type->object.begin(); it != type->object.end(); ++it) {
-			fields.insert(it->first);
-		}
-		for (it = object.begin(); it != object.end(); ++it) {
-			if (fields.count(it->first) == 0) return false;
-			fields.erase(it->first);
+		FieldMap::iterator a = object.begin();
+		FieldMap::iterator b = type->object.begin();
+		for (; a != object.end(); ++a, ++b) {
+			if (a->first != b->first) return false;
 		}
-		if (!fields.empty()) return false;
-
-		/*
-		 *	If we get here the fields are the same. Now run through and
-		 *	fail if any of the fields are incompatible
-		 */
 
-		for (it = type->object.begin(); it != type->object.end(); ++it) {
-			ref<JSDeclTemplate> self = object[it->first];
-			if (!self->isCompatible(it->second)) return false;
+		for (a = object.begin(), b = type->object.begin(); a != object.end(); ++a, ++b) {
+			if (!a->second->isCompatible(b->second)) return false;
 		}
 		return true;
 	}
@@ -256,6 +526,48 @@ bool JSDeclTemplate::isCompatible(ref<JSDeclTemplate> type)
 	return true;
 }
 
+/*
+ *	Append the shape of this template. Field names are written as their
+ *	symbol ids.
+ */
+
+bool JSDeclTemplate::appendShape(std::string &shape)
+{
+	char buffer[16];
+
+	switch (declType) {
+		case JSONTYPE_UNDEFINED:
+			shape.push_back('U');
+			return true;
+		case JSONTYPE_BOOLEAN:
+			shape.push_back('B');
+			return true;
+		case JSONTYPE_STRING:
+			shape.push_back('S');
+			return true;
+		case JSONTYPE_NUMBER:
+			shape.push_back('N');
+			return true;
+		case JSONTYPE_ARRAY:
+			shape.push_back('[');
+			return arrayType->appendShape(shape);
+		case JSONTYPE_OBJECT: {
+			FieldMap::iterator it;
+
+			shape.push_back('{');
+			for (it = object.begin(); it != object.end(); ++it) {
+				sprintf(buffer,"%u:",(unsigned)it->first);
+				shape.append(buffer);
+				if (!it->second->appendShape(shape)) return false;
+			}
+			shape.push_back('}');
+			return true;
+		}
+		default:
+			return false;
+	}
+}
+
 /************************************************************************/
 /*																		*/
 /*	Construction/Destruction											*/
@@ -269,6 +581,8 @@ bool JSDeclTemplate::isCompatible(ref<JSDeclTemplate> type)
 
 JSAnalysis::JSAnalysis()
 {
+	feed = JSInternSymbol("feed");		/* Name == feed for top */
+	changed = false;
 }
 
 JSAnalysis::~JSAnalysis()
@@ -285,15 +599,46 @@ JSAnalysis::~JSAnalysis()
 /*	JSAnalysis::addValue
  *
  *		Add value to the list. This parses through the JSON and updates
- *	the object map
+ *	the object map. Returns true if this changed the declarations, as
+ *	addTemplate does
  */
 
-void JSAnalysis::addValue(ref<JSONValue> value)
+bool JSAnalysis::addValue(ref<JSONValue> value)
 {
-	std::string str = "feed";	/* Name == feed for top */
+	return addTemplate(new JSDeclTemplate(value));
+}
 
-	ref<JSDeclTemplate> templ = new JSDeclTemplate(value);
-	addObject(str,templ);
+/*	JSAnalysis::addValue
+ *
+ *		Add a value parsed into an arena
+ */
+
+bool JSAnalysis::addValue(const JSArenaValue *value)
+{
+	return addTemplate(new JSDeclTemplate(value));
+}
+
+/*	JSAnalysis::addValue
+ *
+ *		Add the value held on a tape
+ */
+
+bool JSAnalysis::addValue(const JSTape *tape)
+{
+	return addTemplate(new JSDeclTemplate(tape,0));
+}
+
+/*	JSAnalysis::addTemplate
+ *
+ *		Add the template for a top level value. Returns true if this
+ *	changed the declarations, rather than only the ranges of their values
+ */
+
+bool JSAnalysis::addTemplate(ref<JSDeclTemplate> templ)
+{
+	changed = false;
+	addObject(feed,templ);
+	return changed;
 }
 
 static bool isReservedWord(const std::string &str)
@@ -315,14 +660,137 @@ static bool isReservedWord(const std::string &str)
 	return false;
 }
 
+/*	FieldOrder, SortFields
+ *
+ *		Fields are stored in the order of their symbol ids. Where the order
+ *	matters, as in the order objects are added or written, it is the order
+ *	of their names
+ */
+
+static bool FieldOrder(JSDeclTemplate::FieldMap::iterator a, JSDeclTemplate::FieldMap::iterator b)
+{
+	return JSSymbolName(a->first) < JSSymbolName(b->first);
+}
+
+static void SortFields(JSDeclTemplate *templ, std::vector<JSDeclTemplate::FieldMap::iterator> &fields)
+{
+	JSDeclTemplate::FieldMap::iterator it;
+	for (it = templ->object.begin(); it != templ->object.end(); ++it) {
+		fields.push_back(it);
+	}
+	std::sort(fields.begin(), fields.end(), FieldOrder);
+}
+
+/*	FieldNames
+ *
+ *		The field names of an object template, as a string of symbol ids
+ */
+
+static std::string FieldNames(JSDeclTemplate *templ)
+{
+	std::string ret;
+
+	JSDeclTemplate::FieldMap::iterator it;
+	for (it = templ->object.begin(); it != templ->object.end(); ++it) {
+		ret.append((const char *)&it->first,sizeof(uint32_t));
+	}
+	return ret;
+}
+
+/*	JSAnalysis::placeObject
+ *
+ *		Find the declaration for an object template. This uses the name to
+ *	determine the name of the object we're declaring, creating a new name
+ *	if needed because the objects are not compatible. The template is
+ *	merged into the declaration, or copied to start a new one. Returns the
+ *	name of the declaration.
+ *
+ *		The names tried are Name, Name1, Name2 and so on, and the first
+ *	compatible declaration or unused name wins. Rather than try each in
+ *	turn this only looks at the declarations with the same fields. Names
+ *	past those seen so far are tried in order, as another field name can
+ *	fix up to the same names.
+ */
+
+std::string JSAnalysis::placeObject(uint32_t name, ref<JSDeclTemplate> templ)
+{
+	std::string fields = FieldNames(templ);
+	Variants *v;
+
+	std::unordered_map<uint32_t, Variants *>::iterator sv = symbolVariants.find(name);
+	if (sv != symbolVariants.end()) {
+		v = sv->second;
+	} else {
+		std::string base = FixUp(JSSymbolName(name));
+		std::unordered_map<std::string, Variants>::iterator b = variants.find(base);
+		if (b == variants.end()) {
+			Variants empty;
+			empty.base = base;
+			empty.count = isReservedWord(base) ? 1 : 0;
+			b = variants.insert(std::make_pair(base,empty)).first;
+		}
+		v = &b->second;
+		symbolVariants[name] = v;
+	}
+
+	/*
+	 *	Declarations already seen with the same fields
+	 */
+
+	std::vector<Variant> &list = v->byFields[fields];
+	std::vector<Variant>::iterator it;
+	for (it = list.begin(); it != list.end(); ++it) {
+		if (it->templ->isCompatible(templ)) {
+			if (it->templ->merge(templ,DECLMERGE_OWN)) changed = true;
+			return it->name;
+		}
+	}
+
+	/*
+	 *	Try the names after those
+	 */
+
+	for (;;) {
+		Variant var;
+		int index = v->count++;
+
+		var.name = v->base;
+		if (index > 0) {
+			char buffer[32];
+			sprintf(buffer,"%d",index);
+			var.name += buffer;
+		}
+
+		std::map<std::string, ref<JSDeclTemplate> >::iterator exist = langMap.find(var.name);
+		if (exist == langMap.end()) {
+			ref<JSDeclTemplate> decl = new JSDeclTemplate(templ,var.name);
+			decl->baseName = JSSymbolName(name);
+			langMap[var.name] = decl;
+
+			var.templ = decl;
+			list.push_back(var);
+			changed = true;
+			return var.name;
+		}
+
+		var.templ = exist->second;
+		std::string f = FieldNames(var.templ);
+		v->byFields[f].push_back(var);
+
+		if ((f == fields) && var.templ->isCompatible(templ)) {
+			if (var.templ->merge(templ,DECLMERGE_OWN)) changed = true;
+			return var.name;
+		}
+	}
+}
+
 /*	JSAnalysis::addObject
  *
- *		Add object declaration for individual objects. This uses the name to
- *	determine the name of the object we're declaring. If the type is
+ *		Add object declaration for individual objects. If the type is
  *	not an object, then we sort through the type to figure out what it is.
  */
 
-void JSAnalysis::addObject(const std::string &name, ref<JSDeclTemplate> templ)
+void JSAnalysis::addObject(uint32_t name, ref<JSDeclTemplate> templ)
 {
 	/*
 	 *	if we're an array, we're actually only interested in the underlying
@@ -340,61 +808,110 @@ void JSAnalysis::addObject(const std::string &name, ref<JSDeclTemplate> templ)
 	if (templ->declType != JSONTYPE_OBJECT) return;
 
 	/*
-	 *	We now have a JSON object. Add to the list of json objects by name,
-	 *	creating a new name if needed because the objects are not compatible.
+	 *	We now have a JSON object. Add to the list of json objects by name
 	 */
 
-	bool fix = false;
-	ref<JSDeclTemplate> exist;
+	templ->name = placeObject(name, templ);
 
-	std::string tname = FixUp(name);
-	if (isReservedWord(tname)) {
-		fix = true;
+	/*
+	 *	Now iterate through the contents of the object and add each of the
+	 *	fields inside that object, in the order of their names
+	 */
 
-	} else {
-		/*
-		 *	Word not reserved. Attempt to load as-is
-		 */
+	std::vector<JSDeclTemplate::FieldMap::iterator> fields;
+	SortFields(templ, fields);
 
-		exist = langMap[tname];
-		if (exist == NULL) {
-			langMap[tname] = new JSDeclTemplate(templ,tname);
-			templ->name = tname;
+	std::vector<JSDeclTemplate::FieldMap::iterator>::iterator it;
+	for (it = fields.begin(); it != fields.end(); ++it) {
+		addObject((*it)->first, (*it)->second);
+	}
+}
 
-		} else if (exist->isCompatible(templ)) {
-			exist->merge(templ);
-			templ->name = tname;
+/************************************************************************/
+/*																		*/
+/*	Merge																*/
+/*																		*/
+/************************************************************************/
 
-		} else {
-			fix = true;
-		}
+/*	EntryOrder
+ *
+ *		Sort declarations so that for any one field name they come in the
+ *	order they were created: Feed, Feed1, ... Feed9, Feed10
+ */
+
+static bool EntryOrder(const std::string &a, const std::string &b)
+{
+	if (a.size() != b.size()) return a.size() < b.size();
+	return a < b;
+}
+
+/*	RenameObjects
+ *
+ *		Object templates carry the name of the declaration they were added
+ *	to. Update the names of the templates from another analysis to the
+ *	names of the declarations they ended up in
+ */
+
+static void RenameObjects(JSDeclTemplate *templ, std::map<std::string,std::string> &names, std::unordered_set<JSDeclTemplate *> &visited)
+{
+	if (templ == NULL) return;
+	if (!visited.insert(templ).second) return;
+
+	if ((templ->declType == JSONTYPE_OBJECT) && !templ->name.empty()) {
+		std::map<std::string,std::string>::iterator n = names.find(templ->name);
+		if (n != names.end()) templ->name = n->second;
 	}
 
-	if (fix) {				/* Couldn't write */
-		int i = 1;
-		for (;;) {
-			tname = AppendIndex(name, i++);
-			exist = langMap[tname];
-			if (exist == NULL) {
-				langMap[tname] = new JSDeclTemplate(templ,tname);
-				templ->name = tname;
-				break;
-			} else if (exist->isCompatible(templ)) {
-				exist->merge(templ);
-				templ->name = tname;
-				break;
-			}
-		}
+	RenameObjects(templ->arrayType, names, visited);
+
+	JSDeclTemplate::FieldMap::iterator it;
+	for (it = templ->object.begin(); it != templ->object.end(); ++it) {
+		RenameObjects(it->second, names, visited);
 	}
 
+	std::vector<ref<JSDeclTemplate> >::iterator i;
+	for (i = templ->illegalList.begin(); i != templ->illegalList.end(); ++i) {
+		RenameObjects(*i, names, visited);
+	}
+}
+
+/*	JSAnalysis::merge
+ *
+ *		Merge the declarations from another analysis into this one. Each
+ *	declaration is placed as if an object of that type had been found
+ *	under its original field name: it is merged into a compatible
+ *	declaration, or added under a new name. The other analysis should not
+ *	be used afterwards, as its templates are shared with this one.
+ */
+
+void JSAnalysis::merge(ref<JSAnalysis> analysis)
+{
+	std::vector<std::string> order;
+	std::map<std::string, ref<JSDeclTemplate> >::iterator it;
+
+	for (it = analysis->langMap.begin(); it != analysis->langMap.end(); ++it) {
+		order.push_back(it->first);
+	}
+	std::sort(order.begin(), order.end(), EntryOrder);
+
 	/*
-	 *	Now iterate through the contents of the object and add each of the
-	 *	fields inside that object
+	 *	Place each declaration, noting where it went
 	 */
 
-	std::map<std::string, ref<JSDeclTemplate> >::iterator it;
-	for (it = templ->object.begin(); it != templ->object.end(); ++it) {
-		addObject(it->first, it->second);
+	std::map<std::string,std::string> names;
+	std::vector<std::string>::iterator n;
+	for (n = order.begin(); n != order.end(); ++n) {
+		ref<JSDeclTemplate> templ = analysis->langMap[*n];
+		names[*n] = placeObject(JSInternSymbol(templ->baseName), templ);
+	}
+
+	/*
+	 *	Now fix up the names used by fields which refer to objects
+	 */
+
+	std::unordered_set<JSDeclTemplate *> visited;
+	for (it = analysis->langMap.begin(); it != analysis->langMap.end(); ++it) {
+		RenameObjects(it->second, names, visited);
 	}
 }
 
@@ -406,7 +923,8 @@ void JSAnalysis::addObject(const std::string &name, ref<JSDeclTemplate> templ)
 
 static void WriteDeclaration(ref<JSOutputStream> out, ref<JSDeclTemplate> templ, int indent)
 {
-	std::map<std::string, ref<JSDeclTemplate> >::iterator it;
+	std::vector<JSDeclTemplate::FieldMap::iterator> fields;
+	std::vector<JSDeclTemplate::FieldMap::iterator>::iterator it;
 
 	while (templ->declType == JSONTYPE_ARRAY) {
 		out->writeASCIIString("arrayof ");
@@ -431,11 +949,12 @@ static void WriteDeclaration(ref<JSOutputStream> out, ref<JSDeclTemplate> templ,
 			break;
 		case JSONTYPE_OBJECT:
 			out->writeASCIIString("{\n");
-			for (it = templ->object.begin(); it != templ->object.end(); ++it) {
+			SortFields(templ, fields);
+			for (it = fields.begin(); it != fields.end(); ++it) {
 				for (int i = 0; i <= indent; ++i) out->writeNextChar('\t');
-				out->writeString(it->first);
+				out->writeString(JSSymbolName((*it)->first));
 				out->writeASCIIString(": ");
-				WriteDeclaration(out, it->second, indent+1);
+				WriteDeclaration(out, (*it)->second, indent+1);
 				out->writeASCIIString(",\n");
 			}
 			for (int i = 0; i < indent; ++i) out->writeNextChar('\t');
@@ -444,6 +963,115 @@ static void WriteDeclaration(ref<JSOutputStream> out, ref<JSDeclTemplate> templ,
 	}
 }
 
+/*	FormatNumber
+ *
+ *		The shortest text which reads back as the same double
+ */
+
+static std::string FormatNumber(double value)
+{
+	char buffer[32];
+
+	for (int precision = 1; precision < 17; ++precision) {
+		sprintf(buffer,"%.*g",precision,value);
+		if (strtod(buffer,NULL) == value) return buffer;
+	}
+	sprintf(buffer,"%.17g",value);
+	return buffer;
+}
+
+/*	QuoteValue
+ *
+ *		Quote a string for a comment, taking care it cannot end the comment
+ */
+
+static std::string QuoteValue(const std::string &value)
+{
+	std::string quoted;
+	for (size_t i = 0; i < value.size(); ++i) {
+		if ((value[i] == '"') || (value[i] == '\\')) quoted.push_back('\\');
+		quoted.push_back(value[i]);
+	}
+
+	std::string esc = EscapeString(quoted);
+	std::string ret = "\"";
+	for (size_t i = 0; i < esc.size(); ++i) {
+		ret.push_back(esc[i]);
+		if ((esc[i] == '*') && (i + 1 < esc.size()) && (esc[i+1] == '/')) ret.push_back('\\');
+	}
+	ret.push_back('"');
+	return ret;
+}
+
+/*	WriteRange
+ *
+ *		Write the range of the values found for a number or string as a
+ *	comment after its type. A string with few distinct values, each found
+ *	more than once on average, is listed as a possible enum
+ */
+
+static void WriteRange(ref<JSOutputStream> out, JSDeclTemplate *decl)
+{
+	const JSDeclRange &r = decl->range;
+	std::string str;
+
+	if (decl->declType == JSONTYPE_NUMBER) {
+		if (!r.hasNumber) return;
+
+		if (!decl->isReal && (r.width <= DECLWIDTH_INT64)) {
+			char buffer[64];
+			sprintf(buffer,"%lld to %lld",(long long)r.minInteger,(long long)r.maxInteger);
+			str = buffer;
+		} else {
+			str = FormatNumber(r.minNumber) + " to " + FormatNumber(r.maxNumber);
+		}
+
+		if (!decl->isReal) {
+			if (r.width == DECLWIDTH_INT32) {
+				str += ", int32";
+			} else if (r.width == DECLWIDTH_INT64) {
+				str += ", int64";
+			} else if ((r.width == DECLWIDTH_UINT64) && (r.minNumber >= 0)) {
+				str += ", uint64";
+			} else {
+				str += ", bigint";
+			}
+		}
+
+	} else if (decl->declType == JSONTYPE_STRING) {
+		if (!r.hasString) return;
+
+		const JSValueSet &v = r.values;
+		uint64_t count = v.getCount();
+		char buffer[64];
+
+		sprintf(buffer,"length %u to %u",(unsigned)r.minLength,(unsigned)r.maxLength);
+		str = buffer;
+
+		if (v.isExact() && (v.getTotal() >= count * 2)) {
+			std::vector<std::string> list;
+			v.getValues(list);
+
+			str += ", enum";
+			std::vector<std::string>::iterator it;
+			for (it = list.begin(); it != list.end(); ++it) {
+				str += (it == list.begin()) ? " " : ", ";
+				str += QuoteValue(*it);
+			}
+		} else {
+			sprintf(buffer,", %s%llu %s",v.isExact() ? "" : "about ",(unsigned long long)count,(count == 1) ? "value" : "values");
+			str += buffer;
+		}
+
+	} else {
+		return;
+	}
+
+	out->writeASCIIString(" /* ");
+	out->writeASCIIString(str.c_str());
+	out->writeASCIIString(" */");
+}
+
 /*	JSAnalysis::generate
  *
  *		Generate to the ouptut stream a language representation of the
@@ -475,8 +1103,13 @@ void JSAnalysis::generate(ref<JSOutputStream> out)
 
 		bool flag = false;
 
-		std::map<std::string, ref<JSDeclTemplate> >::iterator items;
-		for (items = obj->object.begin(); items != obj->object.end(); ++items) {
+		std::vector<JSDeclTemplate::FieldMap::iterator> fields;
+		SortFields(obj, fields);
+
+		std::vector<JSDeclTemplate::FieldMap::iterator>::iterator items;
+		for (items = fields.begin(); items != fields.end(); ++items) {
+			const std::string &field = JSSymbolName((*items)->first);
+
 			if (flag) {
 				out->writeASCIIString(",\n");
 			} else {
@@ -491,12 +1124,12 @@ void JSAnalysis::generate(ref<JSOutputStream> out)
 			 */
 
 			out->writeASCIIString("\t");
-			if (IsValidField(items->first)) {
-				out->writeString(items->first);
+			if (IsValidField(field)) {
+				out->writeString(field);
 			} else {
 				std::string esc;
 				esc = "\"";
-				esc.append(EscapeString(items->first));
+				esc.append(EscapeString(field));
 				esc.push_back('"');
 
 				out->writeString(esc);
@@ -507,7 +1140,7 @@ void JSAnalysis::generate(ref<JSOutputStream> out)
 			 *	We now have a declaration we need to generate
 			 */
 
-			ref<JSDeclTemplate> decl = items->second;
+			ref<JSDeclTemplate> decl = (*items)->second;
 			if ((decl->isNullable) || (decl->isOptional)) {
 				out->writeASCIIString("( ");
 				if (decl->isOptional) {
@@ -549,10 +1182,12 @@ void JSAnalysis::generate(ref<JSOutputStream> out)
 				} else {
 					out->writeASCIIString("integer");
 				}
+				WriteRange(out, decl);
 			} else if (decl->declType == JSONTYPE_BOOLEAN) {
 				out->writeASCIIString("boolean");
 			} else if (decl->declType == JSONTYPE_STRING) {
 				out->writeASCIIString("string");
+				WriteRange(out, decl);
 			} else {
 				out->writeASCIIString("?");
 			}
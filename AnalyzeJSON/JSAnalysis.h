@@ -11,8 +11,11 @@
 
 #include <iostream>
 #include <map>
+#include <unordered_map>
 #include "JSOutputStream.h"
 #include "JSJSONParser.h"
+#include "JSSymbolTable.h"
+#include "JSValueSet.h"
 
 /************************************************************************/
 /*																		*/
@@ -29,6 +32,63 @@
 #define JSONTYPE_UNDEFINED	0
 #define JSONTYPE_ILLEGAL	-1
 
+/*
+ *	The storage the integers found need, narrowest first
+ */
+
+#define DECLWIDTH_NONE		0		/* No integers found */
+#define DECLWIDTH_INT32		1
+#define DECLWIDTH_INT64		2
+#define DECLWIDTH_UINT64	3
+#define DECLWIDTH_BIG		4		/* More than 64 bits */
+
+/*
+ *	Which ranges JSDeclTemplate::merge combines. A declaration only
+ *	counts the values of its own fields; the objects within it are
+ *	declarations of their own, which count theirs when they are placed.
+ */
+
+#define DECLMERGE_ALL		0		/* Every range */
+#define DECLMERGE_OWN		1		/* Not those within nested objects */
+#define DECLMERGE_NONE		2		/* Only types and flags */
+
+/*	JSDeclRange
+ *
+ *		The range of the numbers and strings found for a declaration, and
+ *	the distinct strings. Ranges merge the same way regardless of the order
+ *	values are added in, so they can be gathered separately and combined.
+ */
+
+struct JSDeclRange
+{
+					JSDeclRange()
+						{
+							clear();
+						}
+
+	void			clear();
+	void			addNumber(const JSNumber &value);
+	void			addString(const char *str, size_t length);
+	void			merge(const JSDeclRange &range);
+
+	bool			empty() const
+						{
+							return !hasNumber && !hasString;
+						}
+
+	bool			hasNumber;
+	int32_t			width;				/* Widest integer; DECLWIDTH constant */
+	double			minNumber;
+	double			maxNumber;
+	int64_t			minInteger;			/* Of the integers in an int64_t */
+	int64_t			maxInteger;
+
+	bool			hasString;
+	uint32_t		minLength;			/* In characters */
+	uint32_t		maxLength;
+	JSValueSet		values;
+};
+
 /*	JSDeclTemplate
  *
  *		Declaration template
@@ -42,12 +102,16 @@ class JSDeclTemplate : public JSObject
 								declType = JSONTYPE_UNDEFINED;
 								isNullable = false;
 								isOptional = false;
+								isReal = false;
 							}
 
 						JSDeclTemplate(ref<JSONValue> ref);
+						JSDeclTemplate(const JSArenaValue *val);
+						JSDeclTemplate(const JSTape *tape, size_t index);
 						JSDeclTemplate(ref<JSDeclTemplate> ref, const std::string &name);
 
-		void			merge(ref<JSDeclTemplate> type);
+		bool			merge(ref<JSDeclTemplate> type, int mode = DECLMERGE_ALL);
+		bool			holdsObject();
 
 		/* Used to determine if two JSObject declarations are compatible.
 		 * This is true if both fields have the same set of common fields.
@@ -58,14 +122,30 @@ class JSDeclTemplate : public JSObject
 		 */
 		bool			isCompatible(ref<JSDeclTemplate> type);
 
+		/* Appends a description of the structure of this template: the
+		 * types and field names, without the nullable/optional/real flags.
+		 * Two templates with the same shape are treated identically by
+		 * isCompatible, and merging them only combines their flags.
+		 * Returns false if the template contains an illegal type, as
+		 * those can't be compared this way.
+		 */
+		bool			appendShape(std::string &shape);
+
 		int				declType;
 		bool			isNullable;
 		bool			isOptional;
 		bool			isReal;				/* Is real value */
+		JSDeclRange		range;				/* Values of numbers and strings */
 		std::string		name;				/* Name of object after object added */
+		std::string		baseName;			/* Field name this entry was declared under */
+
+		/* Object fields, keyed by interned field name. Note these are in
+		 * the order of the name ids, not of the names themselves
+		 */
+		typedef std::map<uint32_t, ref<JSDeclTemplate> > FieldMap;
 
 		ref<JSDeclTemplate>	arrayType;		/* Defined only if array type */
-		std::map<std::string, ref<JSDeclTemplate> > object;
+		FieldMap		object;
 		std::vector<ref<JSDeclTemplate> > illegalList;
 };
 
@@ -87,13 +167,48 @@ class JSAnalysis : public JSObject
 						JSAnalysis();
 						~JSAnalysis();
 
-		void			addValue(ref<JSONValue> value);
+		bool			addValue(ref<JSONValue> value);
+		bool			addValue(const JSArenaValue *value);
+		bool			addValue(const JSTape *tape);
+		bool			addTemplate(ref<JSDeclTemplate> templ);
 		void			generate(ref<JSOutputStream> os);
 
+		/*
+		 *	Combining analyses. A snapshot holds the declarations found so
+		 *	far, and can be read back and merged with other analyses
+		 */
+
+		void			merge(ref<JSAnalysis> analysis);
+		void			writeSnapshot(ref<JSOutputStream> os);
+		bool			readSnapshot(ref<JSInputStream> is);
+
 	private:
-		void			addObject(const std::string &name, ref<JSDeclTemplate> templ);
+		/*
+		 *	The declarations for one base name: Name, Name1, Name2 and so
+		 *	on, grouped by the set of field names they have. An object
+		 *	can only be compatible with a declaration with the same fields,
+		 *	and those never change once the declaration is created.
+		 */
+
+		struct Variant {
+			std::string	name;
+			JSDeclTemplate *templ;
+		};
+
+		struct Variants {
+			std::string	base;				/* Fixed up name */
+			int			count;				/* Indexes below this are known */
+			std::unordered_map<std::string, std::vector<Variant> > byFields;
+		};
+
+		void			addObject(uint32_t name, ref<JSDeclTemplate> templ);
+		std::string		placeObject(uint32_t name, ref<JSDeclTemplate> templ);
 
+		uint32_t		feed;
+		bool			changed;			/* Set when a declaration changes */
 		std::map<std::string,ref<JSDeclTemplate> > langMap;
+		std::unordered_map<std::string, Variants> variants;		/* By base name */
+		std::unordered_map<uint32_t, Variants *> symbolVariants;	/* By field name */
 };
 
 
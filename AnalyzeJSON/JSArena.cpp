@@ -0,0 +1,112 @@
+//
+//  JSArena.cpp
+//  AnalyzeJSON
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#include "JSArena.h"
+#include <string.h>
+#include <new>
+
+/************************************************************************/
+/*																		*/
+/*	Construction/Destruction											*/
+/*																		*/
+/************************************************************************/
+
+/*	JSArena::JSArena
+ *
+ *		Construct an empty arena. The first block is allocated on demand
+ */
+
+JSArena::JSArena()
+{
+	index = 0;
+	ptr = NULL;
+	end = NULL;
+}
+
+/*	JSArena::~JSArena
+ *
+ *		Release all the blocks
+ */
+
+JSArena::~JSArena()
+{
+	reset();
+
+	std::vector<uint8_t *>::iterator it;
+	for (it = blocks.begin(); it != blocks.end(); ++it) {
+		free(*it);
+	}
+}
+
+/************************************************************************/
+/*																		*/
+/*	Allocation															*/
+/*																		*/
+/************************************************************************/
+
+/*	JSArena::allocBlock
+ *
+ *		Called when the current block is exhausted. Moves on to the next
+ *	block (allocating if we haven't needed this many before), or for
+ *	oversized requests allocates a block for that request alone
+ */
+
+void *JSArena::allocBlock(size_t size)
+{
+	if (size > ARENABLOCKSIZE / 4) {
+		uint8_t *data = (uint8_t *)malloc(size);
+		if (data == NULL) throw std::bad_alloc();
+		large.push_back(data);
+		return data;
+	}
+
+	if (ptr != NULL) ++index;
+	if (index >= blocks.size()) {
+		uint8_t *data = (uint8_t *)malloc(ARENABLOCKSIZE);
+		if (data == NULL) throw std::bad_alloc();
+		blocks.push_back(data);
+	}
+
+	ptr = blocks[index];
+	end = ptr + ARENABLOCKSIZE;
+
+	void *ret = ptr;
+	ptr += size;
+	return ret;
+}
+
+/*	JSArena::copy
+ *
+ *		Copy a run of bytes into the arena
+ */
+
+const char *JSArena::copy(const char *data, size_t len)
+{
+	char *ret = (char *)alloc(len);
+	memcpy(ret,data,len);
+	return ret;
+}
+
+/*	JSArena::reset
+ *
+ *		Release everything allocated from the arena. The standard sized
+ *	blocks are kept for reuse; oversized blocks are freed
+ */
+
+void JSArena::reset()
+{
+	std::vector<uint8_t *>::iterator it;
+	for (it = large.begin(); it != large.end(); ++it) {
+		free(*it);
+	}
+	large.clear();
+
+	index = 0;
+	ptr = NULL;
+	end = NULL;
+}
@@ -0,0 +1,114 @@
+//
+//  JSArena.h
+//  AnalyzeJSON
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#ifndef __AnalyzeJSON__JSArena__
+#define __AnalyzeJSON__JSArena__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <ctype.h>
+#include <vector>
+#include "JSObject.h"
+
+/************************************************************************/
+/*																		*/
+/*	Arena																*/
+/*																		*/
+/************************************************************************/
+
+#define ARENABLOCKSIZE		65536
+
+/*	JSArena
+ *
+ *		Bump allocator for a single parsed document. Allocations are carved
+ *	out of large blocks and are never freed individually; reset() releases
+ *	everything at once and keeps the blocks around for the next document.
+ */
+
+class JSArena : public JSObject
+{
+	public:
+						JSArena();
+						~JSArena();
+
+		void			*alloc(size_t size)
+							{
+								size = (size + 7) & ~(size_t)7;
+								if ((size_t)(end - ptr) < size) return allocBlock(size);
+
+								void *ret = ptr;
+								ptr += size;
+								return ret;
+							}
+
+		const char		*copy(const char *data, size_t len);
+		void			reset();
+
+	private:
+		std::vector<uint8_t *> blocks;		/* ARENABLOCKSIZE blocks */
+		std::vector<uint8_t *> large;		/* Oversized allocations */
+		size_t			index;				/* Block currently in use */
+
+		uint8_t			*ptr;
+		uint8_t			*end;
+
+		void			*allocBlock(size_t size);
+};
+
+/************************************************************************/
+/*																		*/
+/*	Arena Values														*/
+/*																		*/
+/************************************************************************/
+
+/*	JSArenaValue
+ *
+ *		A JSON value stored in an arena. Unlike JSONValue these are plain
+ *	structures with no reference count; everything a value points to lives
+ *	in the same arena, and goes away when the arena is reset. Array elements
+ *	and object members are stored contiguously.
+ */
+
+struct JSArenaMember;
+
+struct JSArenaValue
+{
+	int32_t				type;			/* JSONTYPE constant */
+	uint32_t			length;			/* Bytes in string, or item count */
+
+	union {
+		bool			boolean;
+		const char		*string;		/* String or number text */
+		JSArenaValue	*array;
+		JSArenaMember	*object;
+	};
+
+	bool				isInteger() const
+							{
+								for (uint32_t i = 0; i < length; ++i) {
+									char c = string[i];
+									if ((c == '.') || (c == 'e') || (c == 'E')) return false;
+								}
+								return true;
+							}
+};
+
+/*	JSArenaMember
+ *
+ *		A key/value pair in an arena object. Members are kept in the order
+ *	they were read, including duplicate keys.
+ */
+
+struct JSArenaMember
+{
+	const char			*key;
+	uint32_t			keyLength;
+	JSArenaValue		value;
+};
+
+#endif /* defined(__AnalyzeJSON__JSArena__) */
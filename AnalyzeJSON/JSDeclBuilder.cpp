@@ -0,0 +1,716 @@
+//
+//  JSDeclBuilder.cpp
+//  AnalyzeJSON
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#include "JSDeclBuilder.h"
+#include <algorithm>
+
+#define NONODE				0xFFFFFFFF
+
+#define DECLFLAG_NULLABLE	0x01
+#define DECLFLAG_OPTIONAL	0x02
+#define DECLFLAG_REAL		0x04
+
+/*
+ *	The table is cleared between documents once it holds this many
+ *	templates, so a long run of unrelated documents does not grow it
+ *	without bound
+ */
+
+#define MAXNODES			65536
+
+/*
+ *	Indexes of the cached scalar templates
+ */
+
+#define SCALAR_STRING		0
+#define SCALAR_INTEGER		1
+#define SCALAR_REAL			2
+#define SCALAR_BOOLEAN		3
+#define SCALAR_NULL			4
+#define SCALAR_UNDEFINED	5
+
+/*
+ *	Paths. The top of the document is path 0; each field and array level
+ *	below it is a path of its own, found from its parent's path and key.
+ *	Array elements all share the key PATH_ELEMENT
+ */
+
+#define PATH_ROOT			0
+#define PATH_ELEMENT		0xFFFFFFFF
+
+/************************************************************************/
+/*																		*/
+/*	Construction/Destruction											*/
+/*																		*/
+/************************************************************************/
+
+/*	JSDeclBuilder::JSDeclBuilder
+ *
+ *		Construction
+ */
+
+JSDeclBuilder::JSDeclBuilder()
+{
+	depth = 0;
+	result = NONODE;
+	arrayLimit = 0;
+	skipping = 0;
+	stopped = false;
+	clear();
+}
+
+JSDeclBuilder::~JSDeclBuilder()
+{
+}
+
+/*	JSDeclBuilder::clear
+ *
+ *		Forget all the templates seen so far. Templates held for values
+ *	seen again are kept aside until they are flushed
+ */
+
+void JSDeclBuilder::clear()
+{
+	nodes.clear();
+	table.clear();
+	merged.clear();
+	returned.clear();
+
+	for (int i = 0; i < 6; ++i) scalars[i] = NONODE;
+
+	std::vector<Pending>::iterator p;
+	for (p = pending.begin(); p != pending.end(); ++p) {
+		flushed.push_back(p->templ);
+	}
+	pending.clear();
+	pendingIndex.clear();
+
+	paths.clear();
+	ranges.clear();
+	ranges.resize(1);					/* PATH_ROOT */
+	touched.clear();
+}
+
+/************************************************************************/
+/*																		*/
+/*	Templates															*/
+/*																		*/
+/************************************************************************/
+
+/*	FieldOrder
+ *
+ *		Order fields by symbol, the order they have in JSDeclTemplate::object
+ */
+
+static bool FieldOrder(const std::pair<uint32_t, uint32_t> &a, const std::pair<uint32_t, uint32_t> &b)
+{
+	return a.first < b.first;
+}
+
+/*	JSDeclBuilder::intern
+ *
+ *		Return the id of the template described by node, adding it if it
+ *	has not been seen before
+ */
+
+uint32_t JSDeclBuilder::intern(Node &node)
+{
+	size_t hash = (size_t)node.declType * 31 + node.flags;
+	bool illegal = (node.declType == JSONTYPE_ILLEGAL);
+
+	hash = hash * 31 + node.arrayType;
+	if (node.arrayType != NONODE) illegal |= nodes[node.arrayType].illegal;
+
+	std::vector<std::pair<uint32_t, uint32_t> >::iterator f;
+	for (f = node.fields.begin(); f != node.fields.end(); ++f) {
+		hash = hash * 31 + f->first;
+		hash = hash * 31 + f->second;
+		illegal |= nodes[f->second].illegal;
+	}
+
+	std::vector<uint32_t>::iterator i;
+	for (i = node.illegalList.begin(); i != node.illegalList.end(); ++i) {
+		hash = hash * 31 + *i;
+	}
+
+	node.hash = hash;
+	node.illegal = illegal;
+
+	/*
+	 *	Find the node if we have it
+	 */
+
+	typedef std::unordered_multimap<size_t, uint32_t>::iterator Iter;
+	std::pair<Iter,Iter> range = table.equal_range(hash);
+	for (Iter it = range.first; it != range.second; ++it) {
+		const Node &n = nodes[it->second];
+		if ((n.declType == node.declType) && (n.flags == node.flags) &&
+				(n.arrayType == node.arrayType) && (n.fields == node.fields) &&
+				(n.illegalList == node.illegalList)) {
+			return it->second;
+		}
+	}
+
+	uint32_t id = (uint32_t)nodes.size();
+	nodes.push_back(node);
+	table.insert(std::make_pair(hash, id));
+	return id;
+}
+
+/*	JSDeclBuilder::scalar
+ *
+ *		Return the id of a template without children. These come up often
+ *	enough that their ids are kept
+ */
+
+uint32_t JSDeclBuilder::scalar(int index, int32_t type, uint8_t flags)
+{
+	if (scalars[index] == NONODE) {
+		Node node;
+		node.declType = type;
+		node.flags = flags;
+		node.arrayType = NONODE;
+		scalars[index] = intern(node);
+	}
+	return scalars[index];
+}
+
+/*	JSDeclBuilder::setFlags
+ *
+ *		Return the id of the template with the given flags added
+ */
+
+uint32_t JSDeclBuilder::setFlags(uint32_t id, uint8_t flags)
+{
+	if ((nodes[id].flags & flags) == flags) return id;
+
+	Node node = nodes[id];
+	node.flags |= flags;
+	return intern(node);
+}
+
+/*	JSDeclBuilder::mergeNodes
+ *
+ *		Return the id of the template which results from merging b into a.
+ *	This follows JSDeclTemplate::merge step for step, but as the templates
+ *	here never change the result is a new template.
+ *
+ *		Merging a template with itself changes nothing unless it holds an
+ *	illegal type, where the list of types found would grow.
+ */
+
+uint32_t JSDeclBuilder::mergeNodes(uint32_t a, uint32_t b)
+{
+	if ((a == b) && !nodes[a].illegal) return a;
+
+	uint64_t key = ((uint64_t)a << 32) | b;
+	std::unordered_map<uint64_t, uint32_t>::iterator m = merged.find(key);
+	if (m != merged.end()) return m->second;
+
+	/*
+	 *	Copies, as nodes can move as templates are added
+	 */
+
+	Node node = nodes[a];
+	Node type = nodes[b];
+
+	node.flags |= type.flags;
+
+	if (node.declType == JSONTYPE_UNDEFINED) {
+		node.declType = type.declType;
+		node.arrayType = type.arrayType;
+		node.fields = type.fields;
+		node.illegalList = type.illegalList;
+
+	} else if (type.declType == JSONTYPE_UNDEFINED) {
+		/*
+		 *	Nothing to do here
+		 */
+
+	} else if (node.declType == JSONTYPE_ILLEGAL) {
+		if (type.declType == JSONTYPE_ILLEGAL) {
+			node.illegalList.insert(node.illegalList.end(),type.illegalList.begin(),type.illegalList.end());
+		} else {
+			node.illegalList.push_back(b);
+		}
+
+	} else if (node.declType != type.declType) {
+		/*
+		 *	Types don't match. The copy of the old declaration keeps only
+		 *	the nullable flag
+		 */
+
+		Node copy;
+		copy.declType = node.declType;
+		copy.flags = node.flags & DECLFLAG_NULLABLE;
+		copy.arrayType = node.arrayType;
+		copy.fields = node.fields;
+		copy.illegalList = node.illegalList;
+
+		node.declType = JSONTYPE_ILLEGAL;
+		node.illegalList.push_back(intern(copy));
+
+		if (type.declType == JSONTYPE_ILLEGAL) {
+			node.illegalList.insert(node.illegalList.end(),type.illegalList.begin(),type.illegalList.end());
+		} else {
+			node.illegalList.push_back(b);
+		}
+
+	} else if (node.declType == JSONTYPE_ARRAY) {
+		node.arrayType = mergeNodes(node.arrayType,type.arrayType);
+
+	} else if (node.declType == JSONTYPE_OBJECT) {
+		/*
+		 *	Both field lists are sorted. Fields on both sides are merged,
+		 *	and the rest are marked optional
+		 */
+
+		std::vector<std::pair<uint32_t, uint32_t> > fields;
+		size_t i = 0, j = 0;
+
+		while ((i < node.fields.size()) || (j < type.fields.size())) {
+			if ((j >= type.fields.size()) || ((i < node.fields.size()) && (node.fields[i].first < type.fields[j].first))) {
+				fields.push_back(std::make_pair(node.fields[i].first,setFlags(node.fields[i].second,DECLFLAG_OPTIONAL)));
+				++i;
+			} else if ((i >= node.fields.size()) || (type.fields[j].first < node.fields[i].first)) {
+				fields.push_back(std::make_pair(type.fields[j].first,setFlags(type.fields[j].second,DECLFLAG_OPTIONAL)));
+				++j;
+			} else {
+				fields.push_back(std::make_pair(node.fields[i].first,mergeNodes(node.fields[i].second,type.fields[j].second)));
+				++i;
+				++j;
+			}
+		}
+		node.fields.swap(fields);
+	}
+
+	uint32_t ret = intern(node);
+	merged[key] = ret;
+	return ret;
+}
+
+/*	JSDeclBuilder::makeTemplate
+ *
+ *		Make the declaration template for an id. Every use of a template
+ *	gets its own copy, as the analysis changes templates as it merges them
+ */
+
+ref<JSDeclTemplate> JSDeclBuilder::makeTemplate(uint32_t id)
+{
+	const Node &node = nodes[id];
+	ref<JSDeclTemplate> templ = new JSDeclTemplate;
+
+	templ->declType = node.declType;
+	templ->isNullable = (node.flags & DECLFLAG_NULLABLE) != 0;
+	templ->isOptional = (node.flags & DECLFLAG_OPTIONAL) != 0;
+	templ->isReal = (node.flags & DECLFLAG_REAL) != 0;
+
+	if (node.arrayType != NONODE) templ->arrayType = makeTemplate(node.arrayType);
+
+	std::vector<std::pair<uint32_t, uint32_t> >::const_iterator f;
+	for (f = node.fields.begin(); f != node.fields.end(); ++f) {
+		templ->object.insert(templ->object.end(),std::make_pair(f->first,makeTemplate(f->second)));
+	}
+
+	std::vector<uint32_t>::const_iterator i;
+	for (i = node.illegalList.begin(); i != node.illegalList.end(); ++i) {
+		templ->illegalList.push_back(makeTemplate(*i));
+	}
+
+	return templ;
+}
+
+/************************************************************************/
+/*																		*/
+/*	Ranges																*/
+/*																		*/
+/************************************************************************/
+
+/*	JSDeclBuilder::childPath
+ *
+ *		Return the path for a key within the given path
+ */
+
+uint32_t JSDeclBuilder::childPath(uint32_t path, uint32_t key)
+{
+	uint64_t k = ((uint64_t)path << 32) | key;
+
+	std::unordered_map<uint64_t, uint32_t>::iterator it = paths.find(k);
+	if (it != paths.end()) return it->second;
+
+	uint32_t id = (uint32_t)ranges.size();
+	ranges.resize(id+1);
+	paths[k] = id;
+	return id;
+}
+
+/*	JSDeclBuilder::valuePath
+ *
+ *		The path of the value being parsed
+ */
+
+uint32_t JSDeclBuilder::valuePath()
+{
+	return (depth == 0) ? PATH_ROOT : stack[depth-1].valuePath;
+}
+
+/*	JSDeclBuilder::getRange
+ *
+ *		The range for the path of the value being parsed in this document
+ */
+
+JSDeclRange &JSDeclBuilder::getRange()
+{
+	uint32_t path = valuePath();
+	JSDeclRange &r = ranges[path];
+
+	if (r.empty()) touched.push_back(path);
+	return r;
+}
+
+/*	JSDeclBuilder::findLeaves
+ *
+ *		Find the number and string templates in a template made from a
+ *	node, with their paths. The members of an illegal type are all at the
+ *	path of the illegal type
+ */
+
+void JSDeclBuilder::findLeaves(JSDeclTemplate *templ, uint32_t path, std::vector<std::pair<uint32_t, JSDeclTemplate *> > &leaves)
+{
+	std::unordered_map<uint64_t, uint32_t>::iterator p;
+
+	switch (templ->declType) {
+		case JSONTYPE_NUMBER:
+		case JSONTYPE_STRING:
+			leaves.push_back(std::make_pair(path,templ));
+			break;
+
+		case JSONTYPE_ARRAY:
+			p = paths.find(((uint64_t)path << 32) | PATH_ELEMENT);
+			if (p != paths.end()) findLeaves(templ->arrayType,p->second,leaves);
+			break;
+
+		case JSONTYPE_OBJECT: {
+			JSDeclTemplate::FieldMap::iterator f;
+			for (f = templ->object.begin(); f != templ->object.end(); ++f) {
+				p = paths.find(((uint64_t)path << 32) | f->first);
+				if (p != paths.end()) findLeaves(f->second,p->second,leaves);
+			}
+			break;
+		}
+
+		case JSONTYPE_ILLEGAL: {
+			std::vector<ref<JSDeclTemplate> >::iterator i;
+			for (i = templ->illegalList.begin(); i != templ->illegalList.end(); ++i) {
+				findLeaves(*i,path,leaves);
+			}
+			break;
+		}
+	}
+}
+
+/*	JSDeclBuilder::addRanges
+ *
+ *		Add the ranges found in this document to the templates
+ */
+
+void JSDeclBuilder::addRanges(const std::vector<std::pair<uint32_t, JSDeclTemplate *> > &leaves)
+{
+	std::vector<std::pair<uint32_t, JSDeclTemplate *> >::const_iterator it;
+	for (it = leaves.begin(); it != leaves.end(); ++it) {
+		const JSDeclRange &r = ranges[it->first];
+		if (!r.empty()) it->second->range.merge(r);
+	}
+}
+
+/************************************************************************/
+/*																		*/
+/*	Results																*/
+/*																		*/
+/************************************************************************/
+
+/*	JSDeclBuilder::getTemplate
+ *
+ *		Return the template for the value just parsed, and get ready for
+ *	the next one. A value identical to one returned before lands on the
+ *	same named objects and merging it again only sets flags which are
+ *	already set, so it is skipped and only its ranges are kept. That does
+ *	not hold for illegal types.
+ */
+
+ref<JSDeclTemplate> JSDeclBuilder::getTemplate()
+{
+	ref<JSDeclTemplate> ret;
+
+	if ((depth == 0) && (result != NONODE)) {
+		if (nodes[result].illegal || returned.insert(result).second) {
+			std::vector<std::pair<uint32_t, JSDeclTemplate *> > leaves;
+
+			ret = makeTemplate(result);
+			findLeaves(ret,PATH_ROOT,leaves);
+			addRanges(leaves);
+
+		} else {
+			std::unordered_map<uint32_t, size_t>::iterator p = pendingIndex.find(result);
+			if (p == pendingIndex.end()) {
+				Pending entry;
+				entry.templ = makeTemplate(result);
+				findLeaves(entry.templ,PATH_ROOT,entry.leaves);
+
+				p = pendingIndex.insert(std::make_pair(result,pending.size())).first;
+				pending.push_back(entry);
+			}
+			addRanges(pending[p->second].leaves);
+		}
+	}
+	result = NONODE;
+
+	std::vector<uint32_t>::iterator t;
+	for (t = touched.begin(); t != touched.end(); ++t) {
+		ranges[*t].clear();
+	}
+	touched.clear();
+
+	while (depth > 0) {
+		stack[--depth].fields.clear();	/* Abandoned by a syntax error */
+	}
+	skipping = 0;
+	stopped = false;
+
+	if (nodes.size() > MAXNODES) clear();
+	return ret;
+}
+
+/*	JSDeclBuilder::flush
+ *
+ *		Hand over the templates holding the ranges of values which were
+ *	not returned because they were seen before
+ */
+
+void JSDeclBuilder::flush(std::vector<ref<JSDeclTemplate> > &list)
+{
+	list.insert(list.end(),flushed.begin(),flushed.end());
+	flushed.clear();
+
+	std::vector<Pending>::iterator p;
+	for (p = pending.begin(); p != pending.end(); ++p) {
+		list.push_back(p->templ);
+	}
+	pending.clear();
+	pendingIndex.clear();
+}
+
+/*	JSDeclBuilder::addValue
+ *
+ *		A value has been completed. Store it in the container we're in: for
+ *	arrays this merges into the element type in the same order the
+ *	JSONValue constructor does
+ */
+
+void JSDeclBuilder::addValue(uint32_t id)
+{
+	if (depth == 0) {
+		result = id;
+		return;
+	}
+
+	Frame &f = stack[depth-1];
+	if (f.declType == JSONTYPE_OBJECT) {
+		f.fields.push_back(std::make_pair(f.key,id));
+		return;
+	}
+
+	if (f.arrayType == NONODE) {
+		f.arrayType = id;
+	} else {
+		f.arrayType = mergeNodes(f.arrayType,id);
+	}
+
+	++f.count;
+	if ((depth == 1) && (arrayLimit > 0) && (f.count >= arrayLimit)) stopped = true;
+}
+
+/*	JSDeclBuilder::skipValue
+ *
+ *		Returns true if the value starting is past the array limit, or is
+ *	inside one which is
+ */
+
+bool JSDeclBuilder::skipValue()
+{
+	if (skipping > 0) return true;
+	if ((depth == 0) || (arrayLimit == 0)) return false;
+
+	const Frame &f = stack[depth-1];
+	return (f.declType == JSONTYPE_ARRAY) && (f.count >= arrayLimit);
+}
+
+/*	JSDeclBuilder::push
+ *
+ *		Start a container
+ */
+
+void JSDeclBuilder::push(int32_t type)
+{
+	uint32_t path = valuePath();
+
+	if (depth >= stack.size()) stack.resize(depth+1);
+
+	Frame &f = stack[depth++];
+	f.declType = type;
+	f.arrayType = NONODE;
+	f.count = 0;
+	f.path = path;
+	if (type == JSONTYPE_ARRAY) f.valuePath = childPath(path,PATH_ELEMENT);
+	f.fields.clear();
+}
+
+/************************************************************************/
+/*																		*/
+/*	Events																*/
+/*																		*/
+/************************************************************************/
+
+/*	JSDeclBuilder events
+ *
+ *		Handle parser events
+ */
+
+void JSDeclBuilder::startObject()
+{
+	if (skipValue()) {
+		++skipping;
+		return;
+	}
+	push(JSONTYPE_OBJECT);
+}
+
+void JSDeclBuilder::key(const JSToken &name)
+{
+	if (skipping > 0) return;
+
+	/*
+	 *	Keys are looked up here first, so the shared symbol table is only
+	 *	locked for names this builder has not seen
+	 */
+
+	Frame &f = stack[depth-1];
+	keyName.assign(name.data,name.length);
+
+	std::unordered_map<std::string, uint32_t>::iterator it = symbols.find(keyName);
+	if (it != symbols.end()) {
+		f.key = it->second;
+	} else {
+		uint32_t symbol = JSInternSymbol(keyName);
+		symbols[keyName] = symbol;
+		f.key = symbol;
+	}
+	f.valuePath = childPath(f.path,f.key);
+}
+
+void JSDeclBuilder::endObject()
+{
+	if (skipping > 0) {
+		--skipping;
+		return;
+	}
+
+	Frame &f = stack[--depth];
+
+	/*
+	 *	Sort the fields. Where a key repeats the last value wins, as it
+	 *	does in JSONObject
+	 */
+
+	std::stable_sort(f.fields.begin(),f.fields.end(),FieldOrder);
+
+	size_t n = 0;
+	for (size_t i = 0; i < f.fields.size(); ++i) {
+		if ((n > 0) && (f.fields[n-1].first == f.fields[i].first)) {
+			f.fields[n-1].second = f.fields[i].second;
+		} else {
+			if (n != i) f.fields[n].swap(f.fields[i]);
+			++n;
+		}
+	}
+	f.fields.resize(n);
+
+	Node node;
+	node.declType = JSONTYPE_OBJECT;
+	node.flags = 0;
+	node.arrayType = NONODE;
+	node.fields.swap(f.fields);
+
+	uint32_t id = intern(node);
+	f.fields.swap(node.fields);
+	f.fields.clear();
+
+	addValue(id);
+}
+
+void JSDeclBuilder::startArray()
+{
+	if (skipValue()) {
+		++skipping;
+		return;
+	}
+	push(JSONTYPE_ARRAY);
+}
+
+void JSDeclBuilder::endArray()
+{
+	if (skipping > 0) {
+		--skipping;
+		return;
+	}
+
+	Frame &f = stack[--depth];
+
+	Node node;
+	node.declType = JSONTYPE_ARRAY;
+	node.flags = 0;
+	node.arrayType = f.arrayType;
+	if (node.arrayType == NONODE) node.arrayType = scalar(SCALAR_UNDEFINED,JSONTYPE_UNDEFINED,0);
+
+	addValue(intern(node));
+}
+
+void JSDeclBuilder::stringValue(const JSToken &value)
+{
+	if (skipValue()) return;
+
+	getRange().addString(value.data,value.length);
+	addValue(scalar(SCALAR_STRING,JSONTYPE_STRING,0));
+}
+
+void JSDeclBuilder::numberValue(const JSToken &, const JSNumber &value)
+{
+	if (skipValue()) return;
+
+	getRange().addNumber(value);
+
+	if (!value.isInteger()) {
+		addValue(scalar(SCALAR_REAL,JSONTYPE_NUMBER,DECLFLAG_REAL));
+	} else {
+		addValue(scalar(SCALAR_INTEGER,JSONTYPE_NUMBER,0));
+	}
+}
+
+void JSDeclBuilder::booleanValue(bool)
+{
+	if (skipValue()) return;
+
+	addValue(scalar(SCALAR_BOOLEAN,JSONTYPE_BOOLEAN,0));
+}
+
+void JSDeclBuilder::nullValue()
+{
+	if (skipValue()) return;
+
+	addValue(scalar(SCALAR_NULL,JSONTYPE_UNDEFINED,DECLFLAG_NULLABLE));
+}
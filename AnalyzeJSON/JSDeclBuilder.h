@@ -0,0 +1,157 @@
+//
+//  JSDeclBuilder.h
+//  AnalyzeJSON
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#ifndef __AnalyzeJSON__JSDeclBuilder__
+#define __AnalyzeJSON__JSDeclBuilder__
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include "JSAnalysis.h"
+
+/************************************************************************/
+/*																		*/
+/*	Declaration Builder													*/
+/*																		*/
+/************************************************************************/
+
+/*	JSDeclBuilder
+ *
+ *		Builds a declaration template directly from parser events, without
+ *	the value ever existing as a DOM. Array elements are merged into the
+ *	array's type as each one completes, so memory use follows the shape of
+ *	the document rather than its size.
+ *
+ *		While building, templates are hash consed: each distinct template
+ *	(type, flags, fields and the ids of its children) is stored once and
+ *	referred to by id. A million identical array elements come down to one
+ *	table lookup each, and merging a template with itself is skipped.
+ *	Merges of two ids are remembered. The JSDeclTemplate tree is only made
+ *	when the document is complete.
+ *
+ *		The ranges of numbers and strings are not part of a template's id,
+ *	or no two documents would share one. They are gathered by path (the
+ *	field names and array levels from the top of the document) and added
+ *	to the templates as they are made.
+ *
+ *		With an array limit only the first elements of each array are
+ *	looked at. Once a top level array has that many, the builder asks the
+ *	parser to stop reading.
+ */
+
+class JSDeclBuilder : public JSJSONHandler
+{
+	public:
+						JSDeclBuilder();
+						~JSDeclBuilder();
+
+		void			startObject();
+		void			key(const JSToken &name);
+		void			endObject();
+
+		void			startArray();
+		void			endArray();
+
+		void			stringValue(const JSToken &value);
+		void			numberValue(const JSToken &text, const JSNumber &value);
+		void			booleanValue(bool value);
+		void			nullValue();
+
+		bool			stopReading()
+							{
+								return stopped;
+							}
+
+		/* Only the first limit elements of an array are used; 0 for all */
+		void			setArrayLimit(uint32_t limit)
+							{
+								arrayLimit = limit;
+							}
+
+		/* Returns the template for the value just parsed. If the value is
+		 * identical to one already returned, adding it to an analysis would
+		 * only widen the ranges found, so this returns NULL instead and
+		 * holds on to the ranges. flush() hands these over as one template
+		 * for each such value, and should be called at the end of the input.
+		 */
+		ref<JSDeclTemplate> getTemplate();
+		void			flush(std::vector<ref<JSDeclTemplate> > &list);
+
+	private:
+		struct Node {
+			int32_t		declType;
+			uint8_t		flags;
+			bool		illegal;			/* This or a child is illegal */
+			uint32_t	arrayType;
+			std::vector<std::pair<uint32_t, uint32_t> > fields;	/* Sorted by symbol */
+			std::vector<uint32_t> illegalList;
+			size_t		hash;
+		};
+
+		struct Frame {
+			int32_t		declType;
+			uint32_t	arrayType;			/* Element type so far */
+			uint32_t	key;				/* Key of the next member */
+			uint32_t	path;				/* Path of this container */
+			uint32_t	valuePath;			/* Path of the next value */
+			uint32_t	count;				/* Elements so far */
+			std::vector<std::pair<uint32_t, uint32_t> > fields;
+		};
+
+		/* A template for values seen again, and where the ranges for each
+		 * path go in it */
+		struct Pending {
+			ref<JSDeclTemplate> templ;
+			std::vector<std::pair<uint32_t, JSDeclTemplate *> > leaves;
+		};
+
+		std::vector<Node> nodes;
+		std::unordered_multimap<size_t, uint32_t> table;
+		std::unordered_map<uint64_t, uint32_t> merged;
+		std::unordered_set<uint32_t> returned;
+		uint32_t		scalars[6];
+
+		std::unordered_map<uint64_t, uint32_t> paths;
+		std::vector<JSDeclRange> ranges;	/* By path, for this document */
+		std::vector<uint32_t> touched;		/* Paths with ranges */
+
+		std::unordered_map<uint32_t, size_t> pendingIndex;
+		std::vector<Pending> pending;
+		std::vector<ref<JSDeclTemplate> > flushed;
+
+		std::unordered_map<std::string, uint32_t> symbols;	/* Symbols seen */
+		std::string		keyName;
+
+		std::vector<Frame> stack;			/* Reused between documents */
+		size_t			depth;
+		uint32_t		result;
+
+		uint32_t		arrayLimit;
+		size_t			skipping;			/* Depth in a value being skipped */
+		bool			stopped;
+
+		void			clear();
+		uint32_t		intern(Node &node);
+		uint32_t		scalar(int index, int32_t type, uint8_t flags);
+		uint32_t		setFlags(uint32_t id, uint8_t flags);
+		uint32_t		mergeNodes(uint32_t a, uint32_t b);
+		ref<JSDeclTemplate> makeTemplate(uint32_t id);
+
+		uint32_t		childPath(uint32_t path, uint32_t key);
+		uint32_t		valuePath();
+		JSDeclRange		&getRange();
+		void			findLeaves(JSDeclTemplate *templ, uint32_t path, std::vector<std::pair<uint32_t, JSDeclTemplate *> > &leaves);
+		void			addRanges(const std::vector<std::pair<uint32_t, JSDeclTemplate *> > &leaves);
+
+		void			push(int32_t type);
+		void			addValue(uint32_t id);
+		bool			skipValue();
+};
+
+#endif /* defined(__AnalyzeJSON__JSDeclBuilder__) */
@@ -12,6 +12,93 @@
 #define SYMBOL_FALSE		(SYMBOL_RESERVED + 1)
 #define SYMBOL_NULL			(SYMBOL_RESERVED + 2)
 
+/************************************************************************/
+/*																		*/
+/*	JSONObject															*/
+/*																		*/
+/************************************************************************/
+
+/*	JSONObject::lookup
+ *
+ *		Return the slot in the index for the key: either the slot holding
+ *	the member with that key, or the empty slot where it would go
+ */
+
+size_t JSONObject::lookup(const std::string &key, size_t hash)
+{
+	size_t mask = index.size() - 1;
+	size_t slot = hash & mask;
+
+	while (index[slot]) {
+		if (members[index[slot] - 1].first == key) break;
+		slot = (slot + 1) & mask;
+	}
+	return slot;
+}
+
+/*	JSONObject::buildIndex
+ *
+ *		(Re)build the hash index, sized to stay under half full
+ */
+
+void JSONObject::buildIndex()
+{
+	std::hash<std::string> hash;
+	size_t size = 2 * JSONOBJECT_INDEXSIZE;
+	while (size < members.size() * 2) size <<= 1;
+
+	index.assign(size,0);
+	for (size_t i = 0; i < members.size(); ++i) {
+		index[lookup(members[i].first,hash(members[i].first))] = (uint32_t)(i + 1);
+	}
+}
+
+/*	JSONObject::find
+ *
+ *		Find the member with the given key, or end() if there is none
+ */
+
+JSONObject::iterator JSONObject::find(const std::string &key)
+{
+	if (members.size() <= JSONOBJECT_INDEXSIZE) {
+		for (iterator it = members.begin(); it != members.end(); ++it) {
+			if (it->first == key) return it;
+		}
+		return members.end();
+	}
+
+	if (index.empty()) buildIndex();
+
+	std::hash<std::string> hash;
+	size_t slot = lookup(key,hash(key));
+	if (index[slot] == 0) return members.end();
+	return members.begin() + (index[slot] - 1);
+}
+
+/*	JSONObject::operator []
+ *
+ *		Return the value for the key, adding an empty member if there is
+ *	none
+ */
+
+ref<JSONValue> &JSONObject::operator [] (const std::string &key)
+{
+	iterator it = find(key);
+	if (it != members.end()) return it->second;
+
+	members.push_back(value_type(key,NULL));
+
+	if (!index.empty()) {
+		if (members.size() * 2 > index.size()) {
+			buildIndex();
+		} else {
+			std::hash<std::string> hash;
+			index[lookup(key,hash(key))] = (uint32_t)members.size();
+		}
+	}
+	return members.back().second;
+}
+
 /************************************************************************/
 /*																		*/
 /*	Construction/Destruction											*/
@@ -23,10 +110,14 @@
  *		Construct the parsesr for parsing JSON
  */
 
-JSJSONParser::JSJSONParser(ref<JSInputStream> is)
+JSJSONParser::JSJSONParser(ref<JSInputStream> is, bool strict)
 {
 	const char * const keywords[] = { "true", "false", "null", NULL };
-	lex = new JSLex(is,keywords);
+	lex = new JSLex(is,keywords,strict);
+	arena = NULL;
+	tape = NULL;
+	handler = NULL;
+	partial = false;
 }
 
 /*	JSJSONParser::~JSJSONParser
@@ -66,15 +157,20 @@ ref<JSONValue> JSJSONParser::parseObject()
 		if (token != SYMBOL_STRING) {
 			throw JSException(lex->getLine(),"Syntax error: expected key as string");
 		}
-		std::string key = lex->getTokenValue();
+
+		/*
+		 *	The key is copied straight into the map entry, since the token
+		 *	text is only valid until the next token is read
+		 */
+
+		ref<JSONValue> &value = (*obj)[lex->getTokenValue()];
 
 		token = lex->nextToken();
 		if (token != ':') {
 			throw JSException(lex->getLine(),"Syntax error: expected ':'");
 		}
 
-		ref<JSONValue> value = parse();
-		(*obj)[key] = value;
+		value = parse();
 
 		token = lex->nextToken();
 		if (token == '}') return obj;
@@ -136,12 +232,471 @@ ref<JSONValue> JSJSONParser::parse()
 	}
 
 	if (token == SYMBOL_STRING) {
-		return new JSONString(lex->getTokenValue());
+		return new JSONString(lex->getToken());
 	}
 
 	if ((token == SYMBOL_REAL) || (token == SYMBOL_INTEGER)) {
-		return new JSONNumber(lex->getTokenValue());
+		return new JSONNumber(lex->getToken(),lex->getNumber());
 	}
 
 	throw JSException(lex->getLine(),"Syntax error: unexpected token");
 }
+
+/************************************************************************/
+/*																		*/
+/*	Arena Parsing														*/
+/*																		*/
+/************************************************************************/
+
+/*	JSJSONParser::checkLength
+ *
+ *		Arena values store lengths and counts in 32 bits
+ */
+
+uint32_t JSJSONParser::checkLength(size_t len)
+{
+	if (len > UINT32_MAX) {
+		throw JSException(lex->getLine(),"Value too large");
+	}
+	return (uint32_t)len;
+}
+
+/*	JSJSONParser::parseArenaObject
+ *
+ *		Called after we've read the '{'. Members are gathered on the member
+ *	stack (which may be holding the members of our parents), then moved into
+ *	the arena once we reach the '}'
+ */
+
+void JSJSONParser::parseArenaObject(JSArenaValue *value)
+{
+	size_t base = memberStack.size();
+	int32_t token;
+
+	value->type = JSONTYPE_OBJECT;
+	value->length = 0;
+	value->object = NULL;
+
+	token = lex->nextToken();
+	if (token == '}') return;		/* Empty object */
+	lex->pushToken();
+
+	for (;;) {
+		JSArenaMember member;
+
+		token = lex->nextToken();
+		if (token != SYMBOL_STRING) {
+			throw JSException(lex->getLine(),"Syntax error: expected key as string");
+		}
+
+		JSToken key = lex->getToken();
+		member.keyLength = checkLength(key.length);
+		member.key = arena->copy(key.data,key.length);
+
+		token = lex->nextToken();
+		if (token != ':') {
+			throw JSException(lex->getLine(),"Syntax error: expected ':'");
+		}
+
+		parseArenaValue(lex->nextToken(),&member.value);
+		memberStack.push_back(member);
+
+		token = lex->nextToken();
+		if (token == '}') break;
+		if (token != ',') {
+			throw JSException(lex->getLine(),"Syntax error: expected ','");
+		}
+	}
+
+	size_t len = memberStack.size() - base;
+	value->length = checkLength(len);
+	value->object = (JSArenaMember *)arena->alloc(len * sizeof(JSArenaMember));
+	memcpy(value->object,&memberStack[base],len * sizeof(JSArenaMember));
+	memberStack.resize(base);
+}
+
+/*	JSJSONParser::parseArenaArray
+ *
+ *		Parse array of objects into the arena
+ */
+
+void JSJSONParser::parseArenaArray(JSArenaValue *value)
+{
+	size_t base = itemStack.size();
+	int32_t token;
+
+	value->type = JSONTYPE_ARRAY;
+	value->length = 0;
+	value->array = NULL;
+
+	token = lex->nextToken();
+	if (token == ']') return;		/* Empty array */
+	lex->pushToken();
+
+	for (;;) {
+		JSArenaValue item;
+
+		parseArenaValue(lex->nextToken(),&item);
+		itemStack.push_back(item);
+
+		token = lex->nextToken();
+		if (token == ']') break;		/* End of array */
+		if (token != ',') {
+			throw JSException(lex->getLine(),"Syntax error: expected comma in array");
+		}
+	}
+
+	size_t len = itemStack.size() - base;
+	value->length = checkLength(len);
+	value->array = (JSArenaValue *)arena->alloc(len * sizeof(JSArenaValue));
+	memcpy(value->array,&itemStack[base],len * sizeof(JSArenaValue));
+	itemStack.resize(base);
+}
+
+/*	JSJSONParser::parseArenaValue
+ *
+ *		Parse the value starting with the token provided
+ */
+
+void JSJSONParser::parseArenaValue(int32_t token, JSArenaValue *value)
+{
+	if (token == '{') {
+		parseArenaObject(value);
+
+	} else if (token == '[') {
+		parseArenaArray(value);
+
+	} else if ((token == SYMBOL_TRUE) || (token == SYMBOL_FALSE)) {
+		value->type = JSONTYPE_BOOLEAN;
+		value->length = 0;
+		value->boolean = (token == SYMBOL_TRUE);
+
+	} else if ((token == SYMBOL_NULL) || (token == -1)) {
+		/*
+		 *	EOF in the middle of a container is reported by our caller
+		 *	when it fails to find a separator
+		 */
+
+		value->type = JSONTYPE_NULL;
+		value->length = 0;
+		value->string = NULL;
+
+	} else if ((token == SYMBOL_STRING) || (token == SYMBOL_REAL) || (token == SYMBOL_INTEGER)) {
+		JSToken t = lex->getToken();
+
+		value->type = (token == SYMBOL_STRING) ? JSONTYPE_STRING : JSONTYPE_NUMBER;
+		value->length = checkLength(t.length);
+		value->string = arena->copy(t.data,t.length);
+
+	} else {
+		throw JSException(lex->getLine(),"Syntax error: unexpected token");
+	}
+}
+
+/*	JSJSONParser::parseArena
+ *
+ *		Parse the next top level value into the arena. Returns NULL at the
+ *	end of the input
+ */
+
+JSArenaValue *JSJSONParser::parseArena(JSArena *a)
+{
+	int32_t token;
+
+	token = lex->nextToken();
+	if (token == -1) return NULL;
+
+	arena = a;
+	itemStack.clear();
+	memberStack.clear();
+
+	JSArenaValue *value = (JSArenaValue *)arena->alloc(sizeof(JSArenaValue));
+	parseArenaValue(token,value);
+	return value;
+}
+
+/************************************************************************/
+/*																		*/
+/*	Tape Parsing														*/
+/*																		*/
+/************************************************************************/
+
+/*	JSJSONParser::parseTapeObject
+ *
+ *		Called after we've read the '{'. Writes the start entry, the keys
+ *	and values, then the end entry, and links the start and end together
+ */
+
+void JSJSONParser::parseTapeObject()
+{
+	size_t start = tape->append(TAPE_OBJECT_START,0);
+	int32_t token;
+
+	token = lex->nextToken();
+	if (token != '}') {
+		lex->pushToken();
+
+		for (;;) {
+			token = lex->nextToken();
+			if (token != SYMBOL_STRING) {
+				throw JSException(lex->getLine(),"Syntax error: expected key as string");
+			}
+
+			JSToken key = lex->getToken();
+			tape->appendString(TAPE_STRING,key.data,checkLength(key.length));
+
+			token = lex->nextToken();
+			if (token != ':') {
+				throw JSException(lex->getLine(),"Syntax error: expected ':'");
+			}
+
+			parseTapeValue(lex->nextToken());
+
+			token = lex->nextToken();
+			if (token == '}') break;
+			if (token != ',') {
+				throw JSException(lex->getLine(),"Syntax error: expected ','");
+			}
+		}
+	}
+
+	size_t end = tape->append(TAPE_OBJECT_END,start);
+	tape->setPayload(start,end);
+}
+
+/*	JSJSONParser::parseTapeArray
+ *
+ *		Parse array of objects onto the tape
+ */
+
+void JSJSONParser::parseTapeArray()
+{
+	size_t start = tape->append(TAPE_ARRAY_START,0);
+	int32_t token;
+
+	token = lex->nextToken();
+	if (token != ']') {
+		lex->pushToken();
+
+		for (;;) {
+			parseTapeValue(lex->nextToken());
+
+			token = lex->nextToken();
+			if (token == ']') break;		/* End of array */
+			if (token != ',') {
+				throw JSException(lex->getLine(),"Syntax error: expected comma in array");
+			}
+		}
+	}
+
+	size_t end = tape->append(TAPE_ARRAY_END,start);
+	tape->setPayload(start,end);
+}
+
+/*	JSJSONParser::parseTapeValue
+ *
+ *		Parse the value starting with the token provided
+ */
+
+void JSJSONParser::parseTapeValue(int32_t token)
+{
+	if (token == '{') {
+		parseTapeObject();
+
+	} else if (token == '[') {
+		parseTapeArray();
+
+	} else if (token == SYMBOL_TRUE) {
+		tape->append(TAPE_TRUE,0);
+
+	} else if (token == SYMBOL_FALSE) {
+		tape->append(TAPE_FALSE,0);
+
+	} else if ((token == SYMBOL_NULL) || (token == -1)) {
+		/*
+		 *	EOF in the middle of a container is reported by our caller
+		 *	when it fails to find a separator
+		 */
+
+		tape->append(TAPE_NULL,0);
+
+	} else if ((token == SYMBOL_STRING) || (token == SYMBOL_REAL) || (token == SYMBOL_INTEGER)) {
+		JSToken t = lex->getToken();
+		tape->appendString((token == SYMBOL_STRING) ? TAPE_STRING : TAPE_NUMBER,t.data,checkLength(t.length));
+
+	} else {
+		throw JSException(lex->getLine(),"Syntax error: unexpected token");
+	}
+}
+
+/*	JSJSONParser::parseTape
+ *
+ *		Parse the next top level value onto the tape. Returns false at the
+ *	end of the input
+ */
+
+bool JSJSONParser::parseTape(JSTape *t)
+{
+	int32_t token;
+
+	t->clear();
+
+	token = lex->nextToken();
+	if (token == -1) return false;
+
+	tape = t;
+	parseTapeValue(token);
+	return true;
+}
+
+/************************************************************************/
+/*																		*/
+/*	Event Parsing														*/
+/*																		*/
+/************************************************************************/
+
+/*	JSJSONParser::parseEventObject
+ *
+ *		Called after we've read the '{'. Reports the keys and values to the
+ *	handler, bracketed by the start and end of the object
+ */
+
+void JSJSONParser::parseEventObject()
+{
+	int32_t token;
+
+	handler->startObject();
+
+	token = lex->nextToken();
+	if (token != '}') {
+		lex->pushToken();
+
+		for (;;) {
+			token = lex->nextToken();
+			if (token != SYMBOL_STRING) {
+				throw JSException(lex->getLine(),"Syntax error: expected key as string");
+			}
+
+			handler->key(lex->getToken());
+
+			token = lex->nextToken();
+			if (token != ':') {
+				throw JSException(lex->getLine(),"Syntax error: expected ':'");
+			}
+
+			parseEventValue(lex->nextToken());
+			if (partial || handler->stopReading()) {
+				partial = true;
+				break;
+			}
+
+			token = lex->nextToken();
+			if (token == '}') break;
+			if (token != ',') {
+				throw JSException(lex->getLine(),"Syntax error: expected ','");
+			}
+		}
+	}
+
+	handler->endObject();
+}
+
+/*	JSJSONParser::parseEventArray
+ *
+ *		Report the contents of an array to the handler
+ */
+
+void JSJSONParser::parseEventArray()
+{
+	int32_t token;
+
+	handler->startArray();
+
+	token = lex->nextToken();
+	if (token != ']') {
+		lex->pushToken();
+
+		for (;;) {
+			parseEventValue(lex->nextToken());
+			if (partial || handler->stopReading()) {
+				partial = true;
+				break;
+			}
+
+			token = lex->nextToken();
+			if (token == ']') break;		/* End of array */
+			if (token != ',') {
+				throw JSException(lex->getLine(),"Syntax error: expected comma in array");
+			}
+		}
+	}
+
+	handler->endArray();
+}
+
+/*	JSJSONParser::parseEventValue
+ *
+ *		Parse the value starting with the token provided
+ */
+
+void JSJSONParser::parseEventValue(int32_t token)
+{
+	if (token == '{') {
+		parseEventObject();
+
+	} else if (token == '[') {
+		parseEventArray();
+
+	} else if ((token == SYMBOL_TRUE) || (token == SYMBOL_FALSE)) {
+		handler->booleanValue(token == SYMBOL_TRUE);
+
+	} else if ((token == SYMBOL_NULL) || (token == -1)) {
+		/*
+		 *	EOF in the middle of a container is reported by our caller
+		 *	when it fails to find a separator
+		 */
+
+		handler->nullValue();
+
+	} else if (token == SYMBOL_STRING) {
+		handler->stringValue(lex->getToken());
+
+	} else if ((token == SYMBOL_REAL) || (token == SYMBOL_INTEGER)) {
+		handler->numberValue(lex->getToken(),lex->getNumber());
+
+	} else {
+		throw JSException(lex->getLine(),"Syntax error: unexpected token");
+	}
+}
+
+/*	JSJSONParser::parseEvents
+ *
+ *		Parse the next top level value, reporting it to the handler. Returns
+ *	false at the end of the input
+ */
+
+bool JSJSONParser::parseEvents(JSJSONHandler *h)
+{
+	int32_t token;
+
+	token = lex->nextToken();
+	if (token == -1) return false;
+
+	handler = h;
+	partial = false;
+	parseEventValue(token);
+	return true;
+}
+
+/*	JSJSONParser::skipDocument
+ *
+ *		Skip the next document in newline delimited input: the line its
+ *	first token is on
+ */
+
+bool JSJSONParser::skipDocument()
+{
+	if (lex->nextToken() == -1) return false;
+	lex->skipLine();
+	return true;
+}
@@ -16,6 +16,8 @@
 #include "JSInputStream.h"
 #include "JSObject.h"
 #include "JSLex.h"
+#include "JSArena.h"
+#include "JSTape.h"
 
 /************************************************************************/
 /*																		*/
@@ -57,16 +59,69 @@ class JSONArray : public JSONValue, public std::vector<ref<JSONValue> >
 
 /*	JSONObject
  *
- *		An object
+ *		An object. Members are kept in a flat array in the order they were
+ *	first added, which for the handful of keys most objects have is both
+ *	smaller and faster than a tree. Lookups scan the array until the object
+ *	grows past JSONOBJECT_INDEXSIZE members; then a hash index is built the
+ *	first time a key is looked up, and kept up to date from then on.
+ *
+ *		A key added twice keeps its first position and its last value.
+ *	Objects are built by JSJSONParser::parse(), which AnalyzeJSON uses for
+ *	-dom tree.
  */
 
-class JSONObject : public JSONValue, public std::map<std::string,ref<JSONValue> >
+#define JSONOBJECT_INDEXSIZE	16
+
+class JSONObject : public JSONValue
 {
 	public:
+		typedef std::pair<std::string,ref<JSONValue> > value_type;
+		typedef std::vector<value_type>::iterator iterator;
+		typedef std::vector<value_type>::const_iterator const_iterator;
+
 		int				getJSONType()
 							{
 								return JSONTYPE_OBJECT;
 							}
+
+		iterator		begin()
+							{
+								return members.begin();
+							}
+		iterator		end()
+							{
+								return members.end();
+							}
+		const_iterator	begin() const
+							{
+								return members.begin();
+							}
+		const_iterator	end() const
+							{
+								return members.end();
+							}
+		size_t			size() const
+							{
+								return members.size();
+							}
+		bool			empty() const
+							{
+								return members.empty();
+							}
+
+		iterator		find(const std::string &key);
+		size_t			count(const std::string &key)
+							{
+								return (find(key) == end()) ? 0 : 1;
+							}
+		ref<JSONValue>	&operator [] (const std::string &key);
+
+	private:
+		std::vector<value_type> members;
+		std::vector<uint32_t> index;		/* Member + 1, or 0 if empty */
+
+		size_t			lookup(const std::string &key, size_t hash);
+		void			buildIndex();
 };
 
 /*	JSONBoolean
@@ -127,6 +182,10 @@ class JSONString: public JSONValue, public std::string
 							{
 							}
 
+						JSONString(const JSToken &t) : std::string(t.data,t.length)
+							{
+							}
+
 		int				getJSONType()
 							{
 								return JSONTYPE_STRING;
@@ -149,10 +208,11 @@ class JSONNull: public JSONValue
 
 /*	JSONNumber
  *
- *		A numeric value. Note that we store this as a string for
- *	the time being. The presumption is that when we deserialize this
- *	into containers, we will convert the value to a numeric value at that
- *	point, preserving accuracy
+ *		A numeric value. The text is kept as well as the converted value,
+ *	so that when we deserialize this into containers the value can be
+ *	converted to whatever type is wanted, preserving accuracy. The parser
+ *	passes on the value the lexer converted, which the analysis reads for
+ *	-dom tree rather than converting the text again
  */
 
 class JSONNumber: public JSONValue, public std::string
@@ -160,9 +220,17 @@ class JSONNumber: public JSONValue, public std::string
 	public:
 						JSONNumber()
 							{
+								value.type = JSNUMBER_INTEGER;
+								value.integer = 0;
+								value.real = 0;
 							}
 
 						JSONNumber(const std::string &str) : std::string(str)
+							{
+								JSParseNumber(str.c_str(),str.length(),&value);
+							}
+
+						JSONNumber(const JSToken &t, const JSNumber &n) : std::string(t.data,t.length), value(n)
 							{
 							}
 
@@ -173,11 +241,16 @@ class JSONNumber: public JSONValue, public std::string
 
 		bool			isInteger()
 							{
-								for (std::string::iterator i = begin(); i != end(); ++i) {
-									if (!isdigit(*i)) return false;
-								}
-								return true;
+								return value.isInteger();
+							}
+
+		const JSNumber	&getValue()
+							{
+								return value;
 							}
+
+	private:
+		JSNumber		value;
 };
 
 
@@ -189,7 +262,8 @@ class JSONNumber: public JSONValue, public std::string
 
 /*	JSException
  *
- *		In the evnet there is an error, this is thrown
+ *		In the evnet there is an error, this is thrown. The file name is
+ *	given when reading more than one file.
  */
 
 class JSException : public std::exception
@@ -200,6 +274,25 @@ class JSException : public std::exception
 				char buffer[256];
 				sprintf(buffer,"line %d: %s",l,msg);
 				message = buffer;
+				line = l;
+				text = msg;
+			}
+
+		JSException(const std::string &file, int32_t l, const char *msg)
+			{
+				char buffer[256];
+				if (l > 0) {
+					snprintf(buffer,sizeof(buffer),", line %d: %s",l,msg);
+				} else {
+					snprintf(buffer,sizeof(buffer),": %s",msg);
+				}
+				message = file + buffer;
+				line = l;
+				text = msg;
+			}
+
+		~JSException() throw()
+			{
 			}
 
 		const char *what() const throw()
@@ -207,8 +300,72 @@ class JSException : public std::exception
 				return message.c_str();
 			}
 
+		int32_t getLine() const
+			{
+				return line;
+			}
+
+		const char *getText() const
+			{
+				return text.c_str();
+			}
+
 	private:
 		std::string message;
+		std::string text;
+		int32_t line;
+};
+
+/*	JSJSONHandler
+ *
+ *		Receives the contents of a JSON value as a series of events, in
+ *	document order. Token text passed to the handler is only valid for the
+ *	duration of the call.
+ */
+
+class JSJSONHandler : public JSObject
+{
+	public:
+		virtual void	startObject() = 0;
+		virtual void	key(const JSToken &name) = 0;
+		virtual void	endObject() = 0;
+
+		virtual void	startArray() = 0;
+		virtual void	endArray() = 0;
+
+		virtual void	stringValue(const JSToken &value) = 0;
+		virtual void	numberValue(const JSToken &text, const JSNumber &value) = 0;
+		virtual void	booleanValue(bool value) = 0;
+		virtual void	nullValue() = 0;
+
+		/* Checked after each member of a container. Returning true ends
+		 * the value there, as if every open container had been closed,
+		 * leaving the input part way through it.
+		 */
+		virtual bool	stopReading()
+							{
+								return false;
+							}
+};
+
+/*	JSIgnoreHandler
+ *
+ *		Does nothing with the events. Used to read past a document which
+ *	is not wanted
+ */
+
+class JSIgnoreHandler : public JSJSONHandler
+{
+	public:
+		void			startObject() {}
+		void			key(const JSToken &) {}
+		void			endObject() {}
+		void			startArray() {}
+		void			endArray() {}
+		void			stringValue(const JSToken &) {}
+		void			numberValue(const JSToken &, const JSNumber &) {}
+		void			booleanValue(bool) {}
+		void			nullValue() {}
 };
 
 /*	JSJSONParser
@@ -216,22 +373,85 @@ class JSException : public std::exception
  *		This parses an incoming request using a recursive descent parser.
  *	This returns the results as a JSONValue, with the lex parser at the
  *	appropriate position for the next object--meaning this can be called
- *	multiple times if there are multiple JSON objects in the input stream
+ *	multiple times if there are multiple JSON objects in the input stream.
+ *	In strict mode comments in the input are treated as syntax errors.
+ *
+ *		parseArena() parses the next value into the supplied arena instead
+ *	of building a JSONValue tree. The result is valid until the arena is
+ *	reset. parseTape() replaces the contents of the tape with the next
+ *	value, and returns false at the end of the input.
+ *
+ *		parseEvents() builds nothing at all; the next value is reported to
+ *	the handler as it is read. Returns false at the end of the input. If
+ *	the handler stopped reading part way through, isPartial() is true.
+ *
+ *		For newline delimited input, skipLine() skips the rest of the
+ *	current line, and skipDocument() skips the next document without
+ *	parsing it, returning false at the end of the input.
  */
 
 class JSJSONParser: public JSObject
 {
 	public:
-						JSJSONParser(ref<JSInputStream> is);
+						JSJSONParser(ref<JSInputStream> is, bool strict = false);
 						~JSJSONParser();
 
 		ref<JSONValue>	parse();
+		JSArenaValue	*parseArena(JSArena *arena);
+		bool			parseTape(JSTape *tape);
+		bool			parseEvents(JSJSONHandler *handler);
+
+		bool			isPartial()
+							{
+								return partial;
+							}
+
+		void			skipLine()
+							{
+								lex->skipLine();
+							}
+		bool			skipDocument();
 
 	private:
 		ref<JSLex>		lex;
 
 		ref<JSONValue>	parseObject();
 		ref<JSONValue>	parseArray();
+
+		/*
+		 *	Arena parsing. Items are gathered on these stacks while a
+		 *	container is being read, then copied into the arena in one piece
+		 */
+
+		JSArena			*arena;
+		std::vector<JSArenaValue> itemStack;
+		std::vector<JSArenaMember> memberStack;
+
+		void			parseArenaValue(int32_t token, JSArenaValue *value);
+		void			parseArenaObject(JSArenaValue *value);
+		void			parseArenaArray(JSArenaValue *value);
+		uint32_t		checkLength(size_t len);
+
+		/*
+		 *	Tape parsing
+		 */
+
+		JSTape			*tape;
+
+		void			parseTapeValue(int32_t token);
+		void			parseTapeObject();
+		void			parseTapeArray();
+
+		/*
+		 *	Event parsing
+		 */
+
+		JSJSONHandler	*handler;
+		bool			partial;
+
+		void			parseEventValue(int32_t token);
+		void			parseEventObject();
+		void			parseEventArray();
 };
 
 
@@ -0,0 +1,403 @@
+//
+//  JSParallelAnalysis.cpp
+//  AnalyzeJSON
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#include "JSParallelAnalysis.h"
+#include "JSDeclBuilder.h"
+#include "JSSampler.h"
+#include <thread>
+#include <unordered_map>
+#include <algorithm>
+#include <string.h>
+#include <sys/stat.h>
+
+/*
+ *	Chunks are sized so each thread gets several of them, which evens out
+ *	the load when some parts of the input are denser than others. They are
+ *	not made too large, so that converging can stop before the end
+ */
+
+#define MINCHUNKSIZE		(1 << 20)
+#define MAXCHUNKSIZE		(64 << 20)
+#define CHUNKSPERTHREAD		8
+
+/************************************************************************/
+/*																		*/
+/*	Construction/Destruction											*/
+/*																		*/
+/************************************************************************/
+
+/*	JSParallelAnalysis::JSParallelAnalysis
+ *
+ *		Construct with the analysis the results are added to
+ */
+
+JSParallelAnalysis::JSParallelAnalysis(ref<JSAnalysis> a, int t, bool s)
+{
+	analysis = a;
+	threads = (t < 1) ? 1 : t;
+	strict = s;
+	fraction = 1;
+	arrayLimit = 0;
+	converge = 0;
+	ndjson = true;
+	nextChunk = 0;
+}
+
+JSParallelAnalysis::~JSParallelAnalysis()
+{
+}
+
+/*	JSParallelAnalysis::setSampling
+ *
+ *		Read only a fraction of the documents, and only the first elements
+ *	of arrays; stop once converge documents in a row have added nothing
+ */
+
+void JSParallelAnalysis::setSampling(double f, uint32_t a, uint32_t c)
+{
+	fraction = f;
+	arrayLimit = a;
+	converge = c;
+}
+
+/************************************************************************/
+/*																		*/
+/*	Workers																*/
+/*																		*/
+/************************************************************************/
+
+/*	AddTemplate
+ *
+ *		Add a template to a chunk's list, merging it into an earlier one
+ *	with the same shape if there is one
+ */
+
+static void AddTemplate(ref<JSDeclTemplate> templ, std::vector<ref<JSDeclTemplate> > &list, std::unordered_map<std::string, size_t> &shapes)
+{
+	std::string shape;
+
+	if (!templ->appendShape(shape)) {
+		list.push_back(templ);
+		return;
+	}
+
+	std::unordered_map<std::string, size_t>::iterator it = shapes.find(shape);
+	if (it == shapes.end()) {
+		shapes[shape] = list.size();
+		list.push_back(templ);
+	} else {
+		list[it->second]->merge(templ);
+	}
+}
+
+/*	JSParallelAnalysis::processChunk
+ *
+ *		Parse the documents in a chunk or file. Documents whose templates have the
+ *	same shape are merged together and passed on as one, in the position
+ *	of the first of them. Adding that one merged template has the same
+ *	effect as adding each of them in turn: they land on the same named
+ *	objects, and merging only combines their flags and ranges.
+ */
+
+void JSParallelAnalysis::processChunk(Chunk &chunk)
+{
+	std::vector<ref<JSDeclTemplate> > list;
+	std::unordered_map<std::string, size_t> shapes;
+	ref<JSDeclBuilder> builder = new JSDeclBuilder;
+	JSSampler sampler(fraction);
+	uint64_t records = 0;
+	bool failed = false;
+	int32_t errorLine = 0;
+	std::string errorText;
+
+	try {
+		ref<JSInputStream> is;
+		if (chunk.path.empty()) {
+			is = new JSMemoryInputStream(chunk.data,chunk.size);
+		} else {
+			FILE *f = fopen(chunk.path.c_str(),"rb");
+			if (f == NULL) throw JSException(0,"Unable to read file");
+			is = JSOpenInputStream(f);
+		}
+
+		ref<JSJSONParser> parser = new JSJSONParser(is,strict);
+		ref<JSJSONHandler> ignore = new JSIgnoreHandler;
+
+		builder->setArrayLimit(arrayLimit);
+
+		for (;;) {
+			if (!sampler.sample()) {
+				bool more = ndjson ? parser->skipDocument() : parser->parseEvents(ignore);
+				if (!more) break;
+				continue;
+			}
+
+			if (!parser->parseEvents(builder)) break;
+			++records;
+
+			ref<JSDeclTemplate> templ = builder->getTemplate();
+			if (templ != NULL) AddTemplate(templ,list,shapes);
+
+			if (parser->isPartial()) {
+				if (!ndjson) break;
+				parser->skipLine();
+			}
+		}
+	}
+	catch (JSException &ex) {
+		failed = true;
+		errorLine = ex.getLine();
+		errorText = ex.getText();
+	}
+
+	/*
+	 *	Documents which repeat earlier ones only brought ranges; these
+	 *	have the shape of an earlier document
+	 */
+
+	std::vector<ref<JSDeclTemplate> > repeats;
+	builder->flush(repeats);
+
+	std::vector<ref<JSDeclTemplate> >::iterator r;
+	for (r = repeats.begin(); r != repeats.end(); ++r) {
+		AddTemplate(*r,list,shapes);
+	}
+
+	/*
+	 *	Count the lines so errors in later chunks can be reported with
+	 *	their line in the file
+	 */
+
+	int32_t lines = 0;
+	if (chunk.path.empty()) {
+		const uint8_t *ptr = chunk.data;
+		const uint8_t *end = chunk.data + chunk.size;
+		while (NULL != (ptr = (const uint8_t *)memchr(ptr,'\n',end - ptr))) {
+			++lines;
+			++ptr;
+		}
+	}
+
+	/*
+	 *	Hand the results over. After this we must not touch the templates
+	 */
+
+	std::lock_guard<std::mutex> guard(lock);
+	chunk.templates.swap(list);
+	chunk.lines = lines;
+	chunk.records = records;
+	chunk.failed = failed;
+	chunk.errorLine = errorLine;
+	chunk.errorText = errorText;
+	chunk.done = true;
+	ready.notify_all();
+}
+
+/*	JSParallelAnalysis::worker
+ *
+ *		Worker thread; takes chunks in order until there are none left
+ */
+
+void JSParallelAnalysis::worker()
+{
+	for (;;) {
+		size_t index;
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			if (nextChunk >= chunks.size()) return;
+			index = order[nextChunk++];
+		}
+
+		processChunk(chunks[index]);
+	}
+}
+
+/************************************************************************/
+/*																		*/
+/*	Run Analysis														*/
+/*																		*/
+/************************************************************************/
+
+/*	JSParallelAnalysis::run
+ *
+ *		Analyze newline delimited input held in memory, split into chunks
+ *	at line boundaries. Throws the first syntax error in the input, with
+ *	its line in the input.
+ */
+
+void JSParallelAnalysis::run(const uint8_t *data, size_t size)
+{
+	/*
+	 *	Split at line boundaries
+	 */
+
+	size_t chunkSize = size / (threads * CHUNKSPERTHREAD);
+	if (chunkSize < MINCHUNKSIZE) chunkSize = MINCHUNKSIZE;
+	if (chunkSize > MAXCHUNKSIZE) chunkSize = MAXCHUNKSIZE;
+
+	size_t pos = 0;
+	while (pos < size) {
+		size_t end = size;
+		if (size - pos > chunkSize) {
+			const uint8_t *nl = (const uint8_t *)memchr(data + pos + chunkSize,'\n',size - pos - chunkSize);
+			if (nl) end = (nl - data) + 1;
+		}
+
+		Chunk chunk;
+		chunk.data = data + pos;
+		chunk.size = end - pos;
+		chunk.done = false;
+		chunk.failed = false;
+		chunk.lines = 0;
+		chunk.records = 0;
+		chunk.errorLine = 0;
+		order.push_back(chunks.size());
+		chunks.push_back(chunk);
+
+		pos = end;
+	}
+
+	ndjson = true;
+	process();
+}
+
+/*	LargestFirst
+ *
+ *		Orders chunks by size, largest first
+ */
+
+struct LargestFirst
+{
+	const std::vector<size_t> &sizes;
+
+	LargestFirst(const std::vector<size_t> &s) : sizes(s)
+		{
+		}
+
+	bool operator()(size_t a, size_t b) const
+		{
+			return sizes[a] > sizes[b];
+		}
+};
+
+/*	JSParallelAnalysis::runFiles
+ *
+ *		Analyze the files given, each of which is read whole by one worker.
+ *	Throws the first syntax error in the files, with the file it is in.
+ */
+
+void JSParallelAnalysis::runFiles(const std::vector<std::string> &files, bool nd)
+{
+	std::vector<size_t> sizes;
+
+	std::vector<std::string>::const_iterator it;
+	for (it = files.begin(); it != files.end(); ++it) {
+		struct stat st;
+
+		Chunk chunk;
+		chunk.data = NULL;
+		chunk.size = (stat(it->c_str(),&st) == 0) ? (size_t)st.st_size : 0;
+		chunk.path = *it;
+		chunk.done = false;
+		chunk.failed = false;
+		chunk.lines = 0;
+		chunk.records = 0;
+		chunk.errorLine = 0;
+		order.push_back(chunks.size());
+		sizes.push_back(chunk.size);
+		chunks.push_back(chunk);
+	}
+
+	std::stable_sort(order.begin(),order.end(),LargestFirst(sizes));
+
+	ndjson = nd;
+	process();
+}
+
+/*	JSParallelAnalysis::process
+ *
+ *		Start the workers on the chunks, and add the results of each chunk
+ *	in order as they become available
+ */
+
+void JSParallelAnalysis::process()
+{
+	/*
+	 *	Start the workers. There is no point in more threads than chunks
+	 */
+
+	std::vector<std::thread> pool;
+	size_t count = ((size_t)threads < chunks.size()) ? threads : chunks.size();
+	for (size_t i = 0; i < count; ++i) {
+		pool.push_back(std::thread(&JSParallelAnalysis::worker,this));
+	}
+
+	/*
+	 *	Reduce in input order. Documents within a chunk are not added one
+	 *	at a time, so converging is counted in whole chunks
+	 */
+
+	JSSampler sampler(1,converge);
+	int32_t lineOffset = 0;
+	bool failed = false;
+	int32_t errorLine = 0;
+	std::string errorText;
+	std::string errorPath;
+
+	for (size_t i = 0; i < chunks.size(); ++i) {
+		Chunk &chunk = chunks[i];
+		std::vector<ref<JSDeclTemplate> > list;
+
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			while (!chunk.done) ready.wait(guard);
+			list.swap(chunk.templates);
+
+			if (chunk.failed) {
+				failed = true;
+				errorLine = lineOffset + chunk.errorLine;
+				errorText = chunk.errorText;
+				errorPath = chunk.path;
+				nextChunk = chunks.size();		/* Stop the workers */
+			}
+		}
+
+		/*
+		 *	Documents before the error are still added, as they would be
+		 *	reading one document at a time
+		 */
+
+		bool changed = false;
+		std::vector<ref<JSDeclTemplate> >::iterator it;
+		for (it = list.begin(); it != list.end(); ++it) {
+			if (analysis->addTemplate(*it)) changed = true;
+		}
+
+		if (failed) break;
+		lineOffset += chunk.lines;
+
+		if (sampler.update(changed,chunk.records)) {
+			std::lock_guard<std::mutex> guard(lock);
+			nextChunk = chunks.size();			/* Stop the workers */
+			break;
+		}
+	}
+
+	std::vector<std::thread>::iterator t;
+	for (t = pool.begin(); t != pool.end(); ++t) {
+		t->join();
+	}
+	chunks.clear();
+	order.clear();
+	nextChunk = 0;
+
+	if (failed) {
+		if (errorPath.empty()) throw JSException(errorLine,errorText.c_str());
+		throw JSException(errorPath,errorLine,errorText.c_str());
+	}
+}
@@ -0,0 +1,92 @@
+//
+//  JSParallelAnalysis.h
+//  AnalyzeJSON
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#ifndef __AnalyzeJSON__JSParallelAnalysis__
+#define __AnalyzeJSON__JSParallelAnalysis__
+
+#include <vector>
+#include <string>
+#include <mutex>
+#include <condition_variable>
+#include "JSAnalysis.h"
+
+/************************************************************************/
+/*																		*/
+/*	Parallel Analysis													*/
+/*																		*/
+/************************************************************************/
+
+/*	JSParallelAnalysis
+ *
+ *		Analyzes newline delimited JSON held in memory (usually a mapped
+ *	file) using a pool of worker threads. The input is split into chunks at
+ *	line boundaries; each worker parses a chunk and builds the templates
+ *	for its documents, combining documents of the same shape as it goes.
+ *	The templates are then added to the analysis in input order, so the
+ *	result is the same as reading the documents one at a time.
+ *
+ *		Given a list of files instead, each file is a chunk of its own.
+ *	The largest files are started first, so one large file left until
+ *	last does not hold up the end of the run; the results are still added
+ *	in the order the files were listed.
+ *
+ *		When sampling, each chunk picks its own share of the documents.
+ *	Convergence is checked a chunk at a time as the results are added.
+ *
+ *		JSObject reference counts are not thread safe, so a chunk's
+ *	templates are only touched by its worker until they are handed over.
+ */
+
+class JSParallelAnalysis : public JSObject
+{
+	public:
+						JSParallelAnalysis(ref<JSAnalysis> analysis, int threads, bool strict);
+						~JSParallelAnalysis();
+
+		void			setSampling(double fraction, uint32_t arrayLimit, uint32_t converge);
+		void			run(const uint8_t *data, size_t size);
+		void			runFiles(const std::vector<std::string> &files, bool ndjson);
+
+	private:
+		struct Chunk {
+			const uint8_t *data;
+			size_t		size;
+			std::string	path;				/* File, rather than data */
+
+			bool		done;
+			bool		failed;
+			int32_t		lines;				/* Newlines in the chunk */
+			uint64_t	records;			/* Documents read */
+			int32_t		errorLine;
+			std::string	errorText;
+
+			std::vector<ref<JSDeclTemplate> > templates;
+		};
+
+		ref<JSAnalysis>	analysis;
+		int				threads;
+		bool			strict;
+
+		double			fraction;
+		uint32_t		arrayLimit;
+		uint32_t		converge;
+
+		bool			ndjson;
+
+		std::vector<Chunk> chunks;
+		std::vector<size_t> order;			/* Order chunks are started */
+		size_t			nextChunk;
+		std::mutex		lock;
+		std::condition_variable ready;
+
+		void			worker();
+		void			processChunk(Chunk &chunk);
+		void			process();
+};
+
+#endif /* defined(__AnalyzeJSON__JSParallelAnalysis__) */
@@ -0,0 +1,72 @@
+//
+//  JSSampler.h
+//  AnalyzeJSON
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#ifndef __AnalyzeJSON__JSSampler__
+#define __AnalyzeJSON__JSSampler__
+
+#include <stdint.h>
+
+/************************************************************************/
+/*																		*/
+/*	Sampling															*/
+/*																		*/
+/************************************************************************/
+
+/*	JSSampler
+ *
+ *		Picks which records (top level documents) are read when only a
+ *	fraction of them are wanted, and notes when the declarations found have
+ *	stopped changing. The records picked are spread evenly: with a fraction
+ *	of 0.25 every fourth one is read.
+ *
+ *		A fraction of 1 reads every record; a converge count of 0 never
+ *	stops early.
+ */
+
+class JSSampler
+{
+	public:
+						JSSampler(double f = 1, uint64_t c = 0)
+							{
+								fraction = f;
+								converge = c;
+								index = 0;
+								unchanged = 0;
+							}
+
+		/* Returns true if the next record should be read */
+		bool			sample()
+							{
+								if (fraction >= 1) return true;
+
+								uint64_t i = index++;
+								return (uint64_t)((i + 1) * fraction) != (uint64_t)(i * fraction);
+							}
+
+		/* Note records read, and whether they changed the declarations.
+		 * Returns true once converge records in a row have changed
+		 * nothing.
+		 */
+		bool			update(bool changed, uint64_t records = 1)
+							{
+								if (changed) {
+									unchanged = 0;
+								} else {
+									unchanged += records;
+								}
+								return (converge > 0) && (unchanged >= converge);
+							}
+
+	private:
+		double			fraction;
+		uint64_t		converge;
+		uint64_t		index;
+		uint64_t		unchanged;
+};
+
+#endif /* defined(__AnalyzeJSON__JSSampler__) */
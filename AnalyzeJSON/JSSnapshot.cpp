@@ -0,0 +1,351 @@
+//
+//  JSSnapshot.cpp
+//  AnalyzeJSON
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#include "JSAnalysis.h"
+#include <unordered_map>
+#include <string.h>
+
+/*
+ *	Snapshot file format. All integers are 32 bit little endian, strings
+ *	are a length followed by the bytes. 64 bit values, including doubles,
+ *	are written as two integers, low half first.
+ *
+ *		magic, version
+ *		node count, then for each node:
+ *			declType, flags,
+ *			if SNAPFLAG_NUMBERS: width, min and max number, min and max
+ *				integer,
+ *			if SNAPFLAG_STRINGS: min and max length, then the distinct
+ *				strings: the number of strings (64 bits), the count and
+ *				text of each while they are known, and the sketch
+ *				registers as a string (empty while the strings are known),
+ *			name, baseName,
+ *			array type (node number + 1, or 0 for none),
+ *			field count, then name and node number for each field,
+ *			illegal count, then node number for each
+ *		declaration count, then name and node number for each
+ *
+ *	Templates can be shared, so each one is written once as a node and
+ *	referred to by number. A node only refers to nodes written before it.
+ */
+
+#define SNAPSHOT_MAGIC		0x4E534C4A		/* 'JLSN' */
+#define SNAPSHOT_VERSION	3
+
+#define SNAPFLAG_NULLABLE	0x01
+#define SNAPFLAG_OPTIONAL	0x02
+#define SNAPFLAG_REAL		0x04
+#define SNAPFLAG_NUMBERS	0x08		/* Range of numbers follows */
+#define SNAPFLAG_STRINGS	0x10		/* Range of string lengths follows */
+
+/************************************************************************/
+/*																		*/
+/*	Writing																*/
+/*																		*/
+/************************************************************************/
+
+static void WriteInt(ref<JSOutputStream> os, uint32_t val)
+{
+	char buffer[4];
+
+	buffer[0] = (char)val;
+	buffer[1] = (char)(val >> 8);
+	buffer[2] = (char)(val >> 16);
+	buffer[3] = (char)(val >> 24);
+	os->writeData(4, buffer);
+}
+
+static void WriteInt64(ref<JSOutputStream> os, uint64_t val)
+{
+	WriteInt(os, (uint32_t)val);
+	WriteInt(os, (uint32_t)(val >> 32));
+}
+
+static void WriteDouble(ref<JSOutputStream> os, double val)
+{
+	uint64_t bits;
+	memcpy(&bits, &val, sizeof(bits));
+	WriteInt64(os, bits);
+}
+
+static void WriteStr(ref<JSOutputStream> os, const std::string &str)
+{
+	WriteInt(os, (uint32_t)str.size());
+	os->writeData(str.size(), str.data());
+}
+
+/*	NumberNodes
+ *
+ *		Assign node numbers, children before their parents
+ */
+
+static void NumberNodes(JSDeclTemplate *templ, std::unordered_map<JSDeclTemplate *, uint32_t> &ids, std::vector<JSDeclTemplate *> &nodes)
+{
+	if (templ == NULL) return;
+	if (ids.count(templ)) return;
+
+	NumberNodes(templ->arrayType, ids, nodes);
+
+	JSDeclTemplate::FieldMap::iterator it;
+	for (it = templ->object.begin(); it != templ->object.end(); ++it) {
+		NumberNodes(it->second, ids, nodes);
+	}
+
+	std::vector<ref<JSDeclTemplate> >::iterator i;
+	for (i = templ->illegalList.begin(); i != templ->illegalList.end(); ++i) {
+		NumberNodes(*i, ids, nodes);
+	}
+
+	ids[templ] = (uint32_t)nodes.size();
+	nodes.push_back(templ);
+}
+
+/*	JSAnalysis::writeSnapshot
+ *
+ *		Write the declarations to a snapshot
+ */
+
+void JSAnalysis::writeSnapshot(ref<JSOutputStream> os)
+{
+	std::unordered_map<JSDeclTemplate *, uint32_t> ids;
+	std::vector<JSDeclTemplate *> nodes;
+	std::map<std::string, ref<JSDeclTemplate> >::iterator it;
+
+	for (it = langMap.begin(); it != langMap.end(); ++it) {
+		NumberNodes(it->second, ids, nodes);
+	}
+
+	WriteInt(os, SNAPSHOT_MAGIC);
+	WriteInt(os, SNAPSHOT_VERSION);
+
+	WriteInt(os, (uint32_t)nodes.size());
+	std::vector<JSDeclTemplate *>::iterator n;
+	for (n = nodes.begin(); n != nodes.end(); ++n) {
+		JSDeclTemplate *templ = *n;
+
+		uint32_t flags = 0;
+		if (templ->isNullable) flags |= SNAPFLAG_NULLABLE;
+		if (templ->isOptional) flags |= SNAPFLAG_OPTIONAL;
+		if (templ->isReal) flags |= SNAPFLAG_REAL;
+		if (templ->range.hasNumber) flags |= SNAPFLAG_NUMBERS;
+		if (templ->range.hasString) flags |= SNAPFLAG_STRINGS;
+
+		WriteInt(os, (uint32_t)templ->declType);
+		WriteInt(os, flags);
+
+		const JSDeclRange &r = templ->range;
+		if (r.hasNumber) {
+			WriteInt(os, (uint32_t)r.width);
+			WriteDouble(os, r.minNumber);
+			WriteDouble(os, r.maxNumber);
+			WriteInt64(os, (uint64_t)r.minInteger);
+			WriteInt64(os, (uint64_t)r.maxInteger);
+		}
+		if (r.hasString) {
+			std::vector<std::string> values;
+			r.values.getValues(values);
+			const std::vector<uint8_t> &registers = r.values.getRegisters();
+
+			WriteInt(os, r.minLength);
+			WriteInt(os, r.maxLength);
+			WriteInt64(os, r.values.getTotal());
+			WriteInt(os, (uint32_t)values.size());
+			for (std::vector<std::string>::iterator v = values.begin(); v != values.end(); ++v) {
+				WriteStr(os, *v);
+			}
+			WriteStr(os, std::string(registers.begin(), registers.end()));
+		}
+
+		WriteStr(os, templ->name);
+		WriteStr(os, templ->baseName);
+		WriteInt(os, templ->arrayType ? ids[templ->arrayType] + 1 : 0);
+
+		JSDeclTemplate::FieldMap::iterator f;
+		WriteInt(os, (uint32_t)templ->object.size());
+		for (f = templ->object.begin(); f != templ->object.end(); ++f) {
+			WriteStr(os, JSSymbolName(f->first));
+			WriteInt(os, ids[f->second]);
+		}
+
+		std::vector<ref<JSDeclTemplate> >::iterator i;
+		WriteInt(os, (uint32_t)templ->illegalList.size());
+		for (i = templ->illegalList.begin(); i != templ->illegalList.end(); ++i) {
+			WriteInt(os, ids[*i]);
+		}
+	}
+
+	WriteInt(os, (uint32_t)langMap.size());
+	for (it = langMap.begin(); it != langMap.end(); ++it) {
+		WriteStr(os, it->first);
+		WriteInt(os, ids[it->second]);
+	}
+}
+
+/************************************************************************/
+/*																		*/
+/*	Reading																*/
+/*																		*/
+/************************************************************************/
+
+static bool ReadInt(ref<JSInputStream> is, uint32_t *val)
+{
+	uint32_t ret = 0;
+
+	for (int i = 0; i < 4; ++i) {
+		int32_t ch = is->readNextChar();
+		if (ch < 0) return false;
+		ret |= (uint32_t)ch << (i * 8);
+	}
+	*val = ret;
+	return true;
+}
+
+static bool ReadInt64(ref<JSInputStream> is, uint64_t *val)
+{
+	uint32_t lo, hi;
+
+	if (!ReadInt(is, &lo) || !ReadInt(is, &hi)) return false;
+	*val = ((uint64_t)hi << 32) | lo;
+	return true;
+}
+
+static bool ReadDouble(ref<JSInputStream> is, double *val)
+{
+	uint64_t bits;
+
+	if (!ReadInt64(is, &bits)) return false;
+	memcpy(val, &bits, sizeof(bits));
+	return true;
+}
+
+static bool ReadStr(ref<JSInputStream> is, std::string &str)
+{
+	uint32_t len;
+	const uint8_t *data;
+
+	if (!ReadInt(is, &len)) return false;
+
+	str.clear();
+	while (len > 0) {
+		size_t block = is->peekBlock(&data);
+		if (block == 0) return false;
+		if (block > len) block = len;
+
+		str.append((const char *)data, block);
+		is->skipBlock(block);
+		len -= (uint32_t)block;
+	}
+	return true;
+}
+
+/*	JSAnalysis::readSnapshot
+ *
+ *		Read the declarations from a snapshot, replacing the declarations
+ *	in this analysis. Returns false if this is not a valid snapshot
+ */
+
+bool JSAnalysis::readSnapshot(ref<JSInputStream> is)
+{
+	uint32_t val, count;
+	std::vector<ref<JSDeclTemplate> > nodes;
+
+	if (!ReadInt(is, &val) || (val != SNAPSHOT_MAGIC)) return false;
+	if (!ReadInt(is, &val) || (val != SNAPSHOT_VERSION)) return false;
+
+	if (!ReadInt(is, &count)) return false;
+	for (uint32_t n = 0; n < count; ++n) {
+		ref<JSDeclTemplate> templ = new JSDeclTemplate;
+		uint32_t flags, num, id;
+
+		if (!ReadInt(is, &val)) return false;
+		templ->declType = (int32_t)val;
+
+		if (!ReadInt(is, &flags)) return false;
+		templ->isNullable = (flags & SNAPFLAG_NULLABLE) != 0;
+		templ->isOptional = (flags & SNAPFLAG_OPTIONAL) != 0;
+		templ->isReal = (flags & SNAPFLAG_REAL) != 0;
+
+		JSDeclRange &r = templ->range;
+		if (flags & SNAPFLAG_NUMBERS) {
+			uint64_t minInteger, maxInteger;
+
+			if (!ReadInt(is, &val) || (val > DECLWIDTH_BIG)) return false;
+			r.width = (int32_t)val;
+			if (!ReadDouble(is, &r.minNumber)) return false;
+			if (!ReadDouble(is, &r.maxNumber)) return false;
+			if (!ReadInt64(is, &minInteger)) return false;
+			if (!ReadInt64(is, &maxInteger)) return false;
+			r.minInteger = (int64_t)minInteger;
+			r.maxInteger = (int64_t)maxInteger;
+			r.hasNumber = true;
+		}
+		if (flags & SNAPFLAG_STRINGS) {
+			uint64_t total;
+			std::vector<std::string> values;
+			std::string registers;
+
+			if (!ReadInt(is, &r.minLength)) return false;
+			if (!ReadInt(is, &r.maxLength)) return false;
+			if (!ReadInt64(is, &total)) return false;
+			if (!ReadInt(is, &num) || (num > VALUESET_EXACT)) return false;
+			values.resize(num);
+			for (uint32_t i = 0; i < num; ++i) {
+				if (!ReadStr(is, values[i])) return false;
+			}
+			if (!ReadStr(is, registers)) return false;
+			if (!registers.empty() && (registers.size() != VALUESET_REGISTERS)) return false;
+
+			r.values.restore(total, values, std::vector<uint8_t>(registers.begin(), registers.end()));
+			r.hasString = true;
+		}
+
+		if (!ReadStr(is, templ->name)) return false;
+		if (!ReadStr(is, templ->baseName)) return false;
+
+		if (!ReadInt(is, &id) || (id > n)) return false;
+		if (id) templ->arrayType = nodes[id-1];
+
+		if (!ReadInt(is, &num)) return false;
+		for (uint32_t i = 0; i < num; ++i) {
+			std::string key;
+			if (!ReadStr(is, key)) return false;
+			if (!ReadInt(is, &id) || (id >= n)) return false;
+			templ->object[JSInternSymbol(key)] = nodes[id];
+		}
+
+		if (!ReadInt(is, &num)) return false;
+		for (uint32_t i = 0; i < num; ++i) {
+			if (!ReadInt(is, &id) || (id >= n)) return false;
+			templ->illegalList.push_back(nodes[id]);
+		}
+
+		/*
+		 *	Arrays always have an element type
+		 */
+
+		if ((templ->declType == JSONTYPE_ARRAY) && (templ->arrayType == NULL)) return false;
+
+		nodes.push_back(templ);
+	}
+
+	std::map<std::string, ref<JSDeclTemplate> > map;
+	if (!ReadInt(is, &count)) return false;
+	for (uint32_t n = 0; n < count; ++n) {
+		std::string name;
+		uint32_t id;
+
+		if (!ReadStr(is, name)) return false;
+		if (!ReadInt(is, &id) || (id >= nodes.size())) return false;
+		map[name] = nodes[id];
+	}
+
+	langMap.swap(map);
+	variants.clear();
+	symbolVariants.clear();
+	return true;
+}
@@ -0,0 +1,60 @@
+//
+//  JSSymbolTable.cpp
+//  AnalyzeJSON
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#include "JSSymbolTable.h"
+#include <mutex>
+#include <new>
+#include <unordered_map>
+
+/*
+ *	Names are kept in fixed size blocks which never move, so a name can
+ *	be read without taking the lock while other threads add names
+ */
+
+#define SYMBOLBLOCKBITS		12
+#define SYMBOLBLOCKSIZE		(1 << SYMBOLBLOCKBITS)
+#define SYMBOLBLOCKS		65536
+
+static std::mutex Lock;
+static std::unordered_map<std::string, uint32_t> Symbols;
+static std::string *Blocks[SYMBOLBLOCKS];
+static uint32_t Count;
+
+/*	JSInternSymbol
+ *
+ *		Return the id for a field name, adding it if this is the first time
+ *	it has been seen
+ */
+
+uint32_t JSInternSymbol(const char *data, size_t length)
+{
+	std::string str(data,length);
+	std::lock_guard<std::mutex> guard(Lock);
+
+	std::unordered_map<std::string, uint32_t>::iterator it = Symbols.find(str);
+	if (it != Symbols.end()) return it->second;
+
+	uint32_t block = Count >> SYMBOLBLOCKBITS;
+	if (block >= SYMBOLBLOCKS) throw std::bad_alloc();
+	if (Blocks[block] == NULL) Blocks[block] = new std::string[SYMBOLBLOCKSIZE];
+
+	uint32_t symbol = Count++;
+	Blocks[block][symbol & (SYMBOLBLOCKSIZE - 1)] = str;
+	Symbols[str] = symbol;
+	return symbol;
+}
+
+/*	JSSymbolName
+ *
+ *		Return the name for an id
+ */
+
+const std::string &JSSymbolName(uint32_t symbol)
+{
+	return Blocks[symbol >> SYMBOLBLOCKBITS][symbol & (SYMBOLBLOCKSIZE - 1)];
+}
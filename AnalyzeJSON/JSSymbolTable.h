@@ -0,0 +1,40 @@
+//
+//  JSSymbolTable.h
+//  AnalyzeJSON
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#ifndef __AnalyzeJSON__JSSymbolTable__
+#define __AnalyzeJSON__JSSymbolTable__
+
+#include <stdint.h>
+#include <string>
+
+/************************************************************************/
+/*																		*/
+/*	Symbol Table														*/
+/*																		*/
+/************************************************************************/
+
+/*
+ *	Field names are interned: each distinct name is given a small integer
+ *	id which it keeps for the life of the program, so names can be stored,
+ *	compared and hashed as numbers. Ids are handed out in the order names
+ *	are first seen, so they do not sort the same way as the names do.
+ *
+ *	Both functions may be called from any thread. An id can be passed to
+ *	JSSymbolName on any thread which obtained it, or was handed it under a
+ *	lock.
+ */
+
+extern uint32_t JSInternSymbol(const char *data, size_t length);
+extern const std::string &JSSymbolName(uint32_t symbol);
+
+inline uint32_t JSInternSymbol(const std::string &str)
+{
+	return JSInternSymbol(str.data(),str.size());
+}
+
+#endif /* defined(__AnalyzeJSON__JSSymbolTable__) */
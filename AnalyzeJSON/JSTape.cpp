@@ -0,0 +1,32 @@
+//
+//  JSTape.cpp
+//  AnalyzeJSON
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#include "JSTape.h"
+
+/************************************************************************/
+/*																		*/
+/*	Construction														*/
+/*																		*/
+/************************************************************************/
+
+/*	JSTape::appendString
+ *
+ *		Copy the text into the string buffer, and add an entry which
+ *	refers to it
+ */
+
+size_t JSTape::appendString(uint8_t type, const char *data, uint32_t length)
+{
+	size_t offset = strings.size();
+
+	strings.resize(offset + sizeof(uint32_t) + length);
+	memcpy(&strings[offset],&length,sizeof(uint32_t));
+	if (length) memcpy(&strings[offset + sizeof(uint32_t)],data,length);
+
+	return append(type,offset);
+}
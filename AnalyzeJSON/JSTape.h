@@ -0,0 +1,141 @@
+//
+//  JSTape.h
+//  AnalyzeJSON
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#ifndef __AnalyzeJSON__JSTape__
+#define __AnalyzeJSON__JSTape__
+
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include <vector>
+#include "JSObject.h"
+
+/************************************************************************/
+/*																		*/
+/*	Tape Entries														*/
+/*																		*/
+/************************************************************************/
+
+/*
+ *	Each tape entry is 64 bits: the entry type in the top 8 bits, and a
+ *	56 bit payload. For containers the payload is the index of the matching
+ *	entry (the start points at its end, and the end back at its start). For
+ *	strings, keys and numbers the payload is the offset of the text in the
+ *	string buffer, which holds a 32 bit length followed by the bytes.
+ */
+
+#define TAPE_OBJECT_START	'{'
+#define TAPE_OBJECT_END		'}'
+#define TAPE_ARRAY_START	'['
+#define TAPE_ARRAY_END		']'
+#define TAPE_STRING			'"'			/* Also used for object keys */
+#define TAPE_NUMBER			'#'
+#define TAPE_TRUE			't'
+#define TAPE_FALSE			'f'
+#define TAPE_NULL			'n'
+
+#define TAPE_PAYLOAD		0x00FFFFFFFFFFFFFFULL
+
+/************************************************************************/
+/*																		*/
+/*	Tape																*/
+/*																		*/
+/************************************************************************/
+
+/*	JSTape
+ *
+ *		A parsed JSON document laid out as a flat array of tape entries in
+ *	document order, with the text of strings and numbers in a separate
+ *	buffer. An object is its start entry, then alternating key and value
+ *	entries, then its end entry. The tape can be reused for the next
+ *	document by calling clear().
+ */
+
+class JSTape : public JSObject
+{
+	public:
+		void			clear()
+							{
+								tape.clear();
+								strings.clear();
+							}
+
+		/*
+		 *	Entry access
+		 */
+
+		size_t			size() const
+							{
+								return tape.size();
+							}
+
+		uint8_t			getType(size_t index) const
+							{
+								return (uint8_t)(tape[index] >> 56);
+							}
+
+		uint64_t		getPayload(size_t index) const
+							{
+								return tape[index] & TAPE_PAYLOAD;
+							}
+
+		const char		*getString(size_t index, uint32_t *length) const
+							{
+								const char *ptr = &strings[getPayload(index)];
+								memcpy(length,ptr,sizeof(uint32_t));
+								return ptr + sizeof(uint32_t);
+							}
+
+		bool			isInteger(size_t index) const
+							{
+								uint32_t len;
+								const char *str = getString(index,&len);
+								for (uint32_t i = 0; i < len; ++i) {
+									char c = str[i];
+									if ((c == '.') || (c == 'e') || (c == 'E')) return false;
+								}
+								return true;
+							}
+
+		/*
+		 *	Index of the entry after the value at index; skips over the
+		 *	contents of containers
+		 */
+
+		size_t			next(size_t index) const
+							{
+								uint8_t type = getType(index);
+								if ((type == TAPE_OBJECT_START) || (type == TAPE_ARRAY_START)) {
+									return (size_t)getPayload(index) + 1;
+								}
+								return index + 1;
+							}
+
+		/*
+		 *	Construction, used by the parser
+		 */
+
+		size_t			append(uint8_t type, uint64_t payload)
+							{
+								tape.push_back(((uint64_t)type << 56) | payload);
+								return tape.size() - 1;
+							}
+
+		void			setPayload(size_t index, uint64_t payload)
+							{
+								tape[index] = (tape[index] & ~TAPE_PAYLOAD) | payload;
+							}
+
+		size_t			appendString(uint8_t type, const char *data, uint32_t length);
+
+	private:
+		std::vector<uint64_t> tape;
+		std::vector<char> strings;
+};
+
+#endif /* defined(__AnalyzeJSON__JSTape__) */
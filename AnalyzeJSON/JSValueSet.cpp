@@ -0,0 +1,227 @@
+//
+//  JSValueSet.cpp
+//  AnalyzeJSON
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#include "JSValueSet.h"
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+/*	Hash
+ *
+ *		64 bit FNV-1a, with the bits mixed afterwards so the high bits
+ *	used to pick a register are as good as the low ones
+ */
+
+static uint64_t Hash(const char *str, size_t length)
+{
+	uint64_t h = 0xCBF29CE484222325ULL;
+
+	for (size_t i = 0; i < length; ++i) {
+		h ^= (uint8_t)str[i];
+		h *= 0x100000001B3ULL;
+	}
+
+	h ^= h >> 33;
+	h *= 0xFF51AFD7ED558CCDULL;
+	h ^= h >> 33;
+	h *= 0xC4CEB9FE1A85EC53ULL;
+	h ^= h >> 33;
+	return h;
+}
+
+/************************************************************************/
+/*																		*/
+/*	Adding Values														*/
+/*																		*/
+/************************************************************************/
+
+/*	JSValueSet::clear
+ *
+ *		Empty the set. Storage is kept for reuse
+ */
+
+void JSValueSet::clear()
+{
+	total = 0;
+	entries.clear();
+	text.clear();
+	registers.clear();
+}
+
+/*	JSValueSet::add
+ *
+ *		Add a string
+ */
+
+void JSValueSet::add(const char *str, size_t length)
+{
+	++total;
+
+	uint64_t hash = Hash(str,length);
+	if (registers.empty()) {
+		addHash(hash,str,length);
+	} else {
+		addRegister(hash);
+	}
+}
+
+/*	JSValueSet::merge
+ *
+ *		Add the strings from another set
+ */
+
+void JSValueSet::merge(const JSValueSet &set)
+{
+	total += set.total;
+
+	if (set.registers.empty()) {
+		std::vector<Entry>::const_iterator it;
+		for (it = set.entries.begin(); it != set.entries.end(); ++it) {
+			if (registers.empty()) {
+				addHash(it->hash,set.text.data() + it->offset,it->length);
+			} else {
+				addRegister(it->hash);
+			}
+		}
+	} else {
+		if (registers.empty()) makeSketch();
+		for (size_t i = 0; i < VALUESET_REGISTERS; ++i) {
+			if (registers[i] < set.registers[i]) registers[i] = set.registers[i];
+		}
+	}
+}
+
+/*	JSValueSet::addHash
+ *
+ *		Add a string to the exact set, if it is not already there. This
+ *	becomes a sketch if the string does not fit
+ */
+
+void JSValueSet::addHash(uint64_t hash, const char *str, size_t length)
+{
+	std::vector<Entry>::iterator it;
+	for (it = entries.begin(); it != entries.end(); ++it) {
+		if ((it->hash == hash) && (it->length == length) && !memcmp(text.data() + it->offset,str,length)) {
+			return;
+		}
+	}
+
+	if ((length > VALUESET_MAXLENGTH) || (entries.size() >= VALUESET_EXACT)) {
+		makeSketch();
+		addRegister(hash);
+		return;
+	}
+
+	Entry e;
+	e.hash = hash;
+	e.offset = (uint32_t)text.size();
+	e.length = (uint32_t)length;
+	entries.push_back(e);
+	text.append(str,length);
+}
+
+/*	JSValueSet::addRegister
+ *
+ *		Add a hash to the sketch. The top bits pick the register, which
+ *	keeps the longest run of leading zeros found in the rest
+ */
+
+void JSValueSet::addRegister(uint64_t hash)
+{
+	uint32_t index = (uint32_t)(hash >> (64 - VALUESET_BITS));
+	uint64_t rest = hash << VALUESET_BITS;
+	uint8_t rank = rest ? (uint8_t)(__builtin_clzll(rest) + 1) : (uint8_t)(64 - VALUESET_BITS + 1);
+
+	if (registers[index] < rank) registers[index] = rank;
+}
+
+/*	JSValueSet::makeSketch
+ *
+ *		Replace the exact set with a sketch
+ */
+
+void JSValueSet::makeSketch()
+{
+	registers.assign(VALUESET_REGISTERS,0);
+
+	std::vector<Entry>::iterator it;
+	for (it = entries.begin(); it != entries.end(); ++it) {
+		addRegister(it->hash);
+	}
+
+	std::vector<Entry>().swap(entries);
+	std::string().swap(text);
+}
+
+/************************************************************************/
+/*																		*/
+/*	Results																*/
+/*																		*/
+/************************************************************************/
+
+/*	JSValueSet::getCount
+ *
+ *		The number of distinct strings. Once a sketch, this is the
+ *	HyperLogLog estimate, using linear counting while there are empty
+ *	registers and the estimate is small
+ */
+
+uint64_t JSValueSet::getCount() const
+{
+	if (registers.empty()) return entries.size();
+
+	double m = VALUESET_REGISTERS;
+	double sum = 0;
+	int zeros = 0;
+
+	std::vector<uint8_t>::const_iterator it;
+	for (it = registers.begin(); it != registers.end(); ++it) {
+		sum += ldexp(1.0,-(int)*it);
+		if (*it == 0) ++zeros;
+	}
+
+	double estimate = (0.7213 / (1 + 1.079 / m)) * m * m / sum;
+	if ((estimate <= 2.5 * m) && (zeros > 0)) {
+		estimate = m * log(m / zeros);
+	}
+	return (uint64_t)(estimate + 0.5);
+}
+
+/*	JSValueSet::getValues
+ *
+ *		The strings in an exact set, sorted
+ */
+
+void JSValueSet::getValues(std::vector<std::string> &list) const
+{
+	std::vector<Entry>::const_iterator it;
+	for (it = entries.begin(); it != entries.end(); ++it) {
+		list.push_back(text.substr(it->offset,it->length));
+	}
+	std::sort(list.begin(),list.end());
+}
+
+/*	JSValueSet::restore
+ *
+ *		Set the contents, as saved from getValues or getRegisters
+ */
+
+void JSValueSet::restore(uint64_t t, const std::vector<std::string> &list, const std::vector<uint8_t> &r)
+{
+	clear();
+
+	if (r.size() == VALUESET_REGISTERS) {
+		registers = r;
+	} else {
+		std::vector<std::string>::const_iterator it;
+		for (it = list.begin(); it != list.end(); ++it) {
+			addHash(Hash(it->data(),it->size()),it->data(),it->size());
+		}
+	}
+	total = t;
+}
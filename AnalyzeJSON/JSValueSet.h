@@ -0,0 +1,91 @@
+//
+//  JSValueSet.h
+//  AnalyzeJSON
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#ifndef __AnalyzeJSON__JSValueSet__
+#define __AnalyzeJSON__JSValueSet__
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/************************************************************************/
+/*																		*/
+/*	Distinct Values														*/
+/*																		*/
+/************************************************************************/
+
+/*
+ *	The exact set holds at most VALUESET_EXACT strings of no more than
+ *	VALUESET_MAXLENGTH bytes; anything more and it becomes a HyperLogLog
+ *	sketch of 2^VALUESET_BITS registers, with an error of about 3%
+ */
+
+#define VALUESET_EXACT		16
+#define VALUESET_MAXLENGTH	64
+#define VALUESET_BITS		10
+#define VALUESET_REGISTERS	(1 << VALUESET_BITS)
+
+/*	JSValueSet
+ *
+ *		Counts the distinct strings found for a declaration. While there
+ *	are few of them, and they are short, the strings themselves are kept;
+ *	past that only an estimate of the count is, in fixed memory. Two sets
+ *	merge to the same result whatever order the strings were added in.
+ */
+
+class JSValueSet
+{
+	public:
+						JSValueSet()
+							{
+								total = 0;
+							}
+
+		void			clear();
+		void			add(const char *str, size_t length);
+		void			merge(const JSValueSet &set);
+
+		/* True if the strings are known, rather than estimated */
+		bool			isExact() const
+							{
+								return registers.empty();
+							}
+
+		uint64_t		getTotal() const	/* Strings added */
+							{
+								return total;
+							}
+
+		uint64_t		getCount() const;	/* Distinct strings */
+		void			getValues(std::vector<std::string> &list) const;
+
+		/* Used to save and restore the set */
+		const std::vector<uint8_t> &getRegisters() const
+							{
+								return registers;
+							}
+		void			restore(uint64_t total, const std::vector<std::string> &list, const std::vector<uint8_t> &registers);
+
+	private:
+		struct Entry {
+			uint64_t	hash;
+			uint32_t	offset;				/* Into text */
+			uint32_t	length;
+		};
+
+		uint64_t		total;
+		std::vector<Entry> entries;			/* While exact */
+		std::string		text;
+		std::vector<uint8_t> registers;		/* Once estimated */
+
+		void			addHash(uint64_t hash, const char *str, size_t length);
+		void			addRegister(uint64_t hash);
+		void			makeSketch();
+};
+
+#endif /* defined(__AnalyzeJSON__JSValueSet__) */
@@ -10,21 +10,231 @@
 #include "JSJSONParser.h"
 #include "JSInputStream.h"
 #include "JSAnalysis.h"
+#include "JSDeclBuilder.h"
+#include "JSParallelAnalysis.h"
+#include "JSSampler.h"
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <errno.h>
+#include <glob.h>
+#include <dirent.h>
+#include <sys/stat.h>
 
-static const char *InFile;
-static const char *OutFile;
+/*
+ *	How documents are read with -dom. By default the declarations are built
+ *	as the input is parsed, without reading the documents into memory
+ */
+
+#define DOM_NONE		0
+#define DOM_TREE		1
+#define DOM_ARENA		2
+#define DOM_TAPE		3
+
+static std::vector<const char *> Files;
+static std::vector<std::string> Inputs;
+static bool Merge;
+static bool Strict;
+static bool NDJSON;
+static int Threads;
+static const char *SnapshotFile;
+static const char *StateFile;
+static double Fraction = 1;
+static uint32_t ArrayLimit;
+static uint32_t Converge;
+static int DOM;
+
+/*	readState
+ *
+ *		Start from the declarations saved by an earlier run, if there was
+ *	one. They are placed as if the input they came from was read first
+ */
+
+static void readState(ref<JSAnalysis> analysis)
+{
+	FILE *f = fopen(StateFile,"rb");
+	if (f == NULL) {
+		if (errno == ENOENT) return;		/* First run */
+		fprintf(stderr,"Unable to read %s\n",StateFile);
+		exit(-1);
+	}
+
+	ref<JSInputStream> is = JSOpenInputStream(f);
+	ref<JSAnalysis> state = new JSAnalysis;
+	if (!state->readSnapshot(is)) {
+		fprintf(stderr,"%s is not a snapshot file\n",StateFile);
+		exit(-1);
+	}
+	analysis->merge(state);
+}
+
+/*	writeSnapshot
+ *
+ *		Write the declarations to a snapshot file. This is written to a
+ *	temporary file which then replaces it, so a snapshot from an earlier
+ *	run is never left half written
+ */
+
+static void writeSnapshot(ref<JSAnalysis> analysis, const char *path)
+{
+	std::string temp = std::string(path) + ".tmp";
+	FILE *f = fopen(temp.c_str(),"wb");
+	if (f == NULL) {
+		fprintf(stderr,"Unable to write %s\n",temp.c_str());
+		exit(-1);
+	}
+
+	bool failed;
+	{
+		ref<JSOutputStream> sout = new JSFileOutputStream(f);
+		analysis->writeSnapshot(sout);
+		failed = (fflush(f) != 0) || ferror(f);
+	}
+
+	if (failed || rename(temp.c_str(),path)) {
+		remove(temp.c_str());
+		fprintf(stderr,"Unable to write %s\n",path);
+		exit(-1);
+	}
+}
+
+static void writeOutput(ref<JSAnalysis> analysis, FILE *out)
+{
+	if (SnapshotFile) writeSnapshot(analysis,SnapshotFile);
+	if (StateFile) writeSnapshot(analysis,StateFile);
+
+	ref<JSOutputStream> sout = new JSFileOutputStream(out);
+	analysis->generate(sout);
+}
+
+static int threadCount()
+{
+	if (Threads > 0) return Threads;
+	return (int)std::thread::hardware_concurrency();
+}
+
+/*	readDocuments
+ *
+ *		Read each document into memory with the parser chosen by -dom, then
+ *	add it to the analysis. This is slower than building the declarations
+ *	as the input is parsed, and is kept to check that against. Returns
+ *	false once the declarations have converged
+ */
+
+static bool readDocuments(ref<JSInputStream> is, ref<JSAnalysis> analysis, JSSampler &sampler)
+{
+	ref<JSJSONParser> parser = new JSJSONParser(is,Strict);
+	ref<JSJSONHandler> ignore = new JSIgnoreHandler;
+	ref<JSArena> arena = new JSArena;
+	ref<JSTape> tape = new JSTape;
+
+	for (;;) {
+		if (!sampler.sample()) {
+			bool more = NDJSON ? parser->skipDocument() : parser->parseEvents(ignore);
+			if (!more) return true;
+			continue;
+		}
+
+		bool changed;
+		if (DOM == DOM_ARENA) {
+			/*
+			 *	The arena holds one document at a time
+			 */
+
+			arena->reset();
+			JSArenaValue *value = parser->parseArena(arena);
+			if (value == NULL) return true;
+			changed = analysis->addValue(value);
+
+		} else if (DOM == DOM_TAPE) {
+			if (!parser->parseTape(tape)) return true;
+			changed = analysis->addValue(tape);
+
+		} else {
+			ref<JSONValue> value = parser->parse();
+			if (value == NULL) return true;
+			changed = analysis->addValue(value);
+		}
+
+		if (sampler.update(changed)) return false;
+	}
+}
 
 static void runAnalysis(FILE *in, FILE *out)
 {
-	ref<JSInputStream> is = new JSFileInputStream(in);
-	ref<JSJSONParser> parser = new JSJSONParser(is);
+	ref<JSInputStream> is = JSOpenInputStream(in);
 	ref<JSAnalysis> analysis = new JSAnalysis;
 
+	if (StateFile) readState(analysis);
+
 	try {
-		for (;;) {
-			ref<JSONValue> v = parser->parse();
-			if (v == NULL) break;
-			analysis->addValue(v);
+		JSMappedInputStream *mapped = dynamic_cast<JSMappedInputStream *>(is.get());
+
+		if (DOM != DOM_NONE) {
+			JSSampler sampler(Fraction,Converge);
+			readDocuments(is,analysis,sampler);
+
+		} else if (NDJSON && mapped) {
+			/*
+			 *	Newline delimited input in a mapped file can be split up
+			 *	between threads. The mapped stream's block is the rest of
+			 *	the file
+			 */
+
+			const uint8_t *data;
+			size_t len = mapped->peekBlock(&data);
+
+			ref<JSParallelAnalysis> parallel = new JSParallelAnalysis(analysis,threadCount(),Strict);
+			parallel->setSampling(Fraction,ArrayLimit,Converge);
+			parallel->run(data,len);
+
+		} else {
+			/*
+			 *	The declaration for each document is built as it is parsed;
+			 *	the document itself is never held in memory
+			 */
+
+			ref<JSJSONParser> parser = new JSJSONParser(is,Strict);
+			ref<JSDeclBuilder> builder = new JSDeclBuilder;
+			ref<JSJSONHandler> ignore = new JSIgnoreHandler;
+			JSSampler sampler(Fraction,Converge);
+
+			builder->setArrayLimit(ArrayLimit);
+
+			for (;;) {
+				if (!sampler.sample()) {
+					bool more = NDJSON ? parser->skipDocument() : parser->parseEvents(ignore);
+					if (!more) break;
+					continue;
+				}
+
+				if (!parser->parseEvents(builder)) break;
+
+				bool changed = false;
+				ref<JSDeclTemplate> templ = builder->getTemplate();
+				if (templ != NULL) changed = analysis->addTemplate(templ);
+
+				/*
+				 *	A document cut short by the array limit leaves the rest
+				 *	of it unread. That is the rest of the line if newline
+				 *	delimited; otherwise we cannot tell where it ends
+				 */
+
+				if (parser->isPartial()) {
+					if (!NDJSON) break;
+					parser->skipLine();
+				}
+
+				if (sampler.update(changed)) break;
+			}
+
+			std::vector<ref<JSDeclTemplate> > repeats;
+			builder->flush(repeats);
+
+			std::vector<ref<JSDeclTemplate> >::iterator it;
+			for (it = repeats.begin(); it != repeats.end(); ++it) {
+				analysis->addTemplate(*it);
+			}
 		}
 	}
 	catch (JSException &ex) {
@@ -32,55 +242,288 @@ static void runAnalysis(FILE *in, FILE *out)
 		exit(-1);
 	}
 
-	ref<JSOutputStream> sout = new JSFileOutputStream(out);
-	analysis->generate(sout);
+	writeOutput(analysis, out);
+}
+
+/*	runFiles
+ *
+ *		Analyze several input files, spread across threads. The result is
+ *	the same as reading the files one after another
+ */
+
+static void runFiles(FILE *out)
+{
+	ref<JSAnalysis> analysis = new JSAnalysis;
+
+	if (StateFile) readState(analysis);
+
+	try {
+		if (DOM != DOM_NONE) {
+			/*
+			 *	Read one file after another, sampling across all of them
+			 */
+
+			JSSampler sampler(Fraction,Converge);
+			std::vector<std::string>::iterator it;
+			for (it = Inputs.begin(); it != Inputs.end(); ++it) {
+				FILE *in = fopen(it->c_str(),"r");
+				if (in == NULL) {
+					fprintf(stderr,"Unable to read %s\n",it->c_str());
+					exit(-1);
+				}
+
+				if (!readDocuments(JSOpenInputStream(in),analysis,sampler)) break;
+			}
+
+		} else {
+			ref<JSParallelAnalysis> parallel = new JSParallelAnalysis(analysis,threadCount(),Strict);
+			parallel->setSampling(Fraction,ArrayLimit,Converge);
+			parallel->runFiles(Inputs,NDJSON);
+		}
+	}
+	catch (JSException &ex) {
+		fprintf(stderr,"%s\n",ex.what());
+		exit(-1);
+	}
+
+	writeOutput(analysis, out);
+}
+
+static void runMerge(FILE *out)
+{
+	ref<JSAnalysis> analysis = new JSAnalysis;
+
+	if (StateFile) readState(analysis);
+
+	for (size_t i = 0; i < Files.size() - 1; ++i) {
+		FILE *in = fopen(Files[i],"rb");
+		if (in == NULL) {
+			fprintf(stderr,"Unable to read %s\n",Files[i]);
+			exit(-1);
+		}
+
+		ref<JSInputStream> is = JSOpenInputStream(in);
+		ref<JSAnalysis> shard = new JSAnalysis;
+		if (!shard->readSnapshot(is)) {
+			fprintf(stderr,"%s is not a snapshot file\n",Files[i]);
+			exit(-1);
+		}
+		analysis->merge(shard);
+	}
+
+	writeOutput(analysis, out);
+}
+
+/*	addInput
+ *
+ *		Add an input file. A directory adds the files in it and in the
+ *	directories below it, in name order, skipping hidden files. A pattern
+ *	the shell did not expand adds the files it matches
+ */
+
+static void addInput(const std::string &path, bool inDirectory)
+{
+	struct stat st;
+
+	if (!inDirectory && (path.find_first_of("*?[") != std::string::npos) && (stat(path.c_str(),&st) != 0)) {
+		glob_t g;
+		if ((glob(path.c_str(),0,NULL,&g) != 0) || (g.gl_pathc == 0)) {
+			fprintf(stderr,"No files match %s\n",path.c_str());
+			exit(-1);
+		}
+		for (size_t i = 0; i < g.gl_pathc; ++i) {
+			addInput(g.gl_pathv[i],false);
+		}
+		globfree(&g);
+		return;
+	}
+
+	/*
+	 *	Within a directory, links to directories are not followed, so a
+	 *	link back up the tree does not loop
+	 */
+
+	if (inDirectory && (lstat(path.c_str(),&st) == 0) && S_ISLNK(st.st_mode)) {
+		if ((stat(path.c_str(),&st) != 0) || !S_ISREG(st.st_mode)) return;
+	} else if (stat(path.c_str(),&st) != 0) {
+		fprintf(stderr,"Unable to read %s\n",path.c_str());
+		exit(-1);
+	}
+
+	if (S_ISDIR(st.st_mode)) {
+		DIR *dir = opendir(path.c_str());
+		if (dir == NULL) {
+			fprintf(stderr,"Unable to read %s\n",path.c_str());
+			exit(-1);
+		}
+
+		std::vector<std::string> names;
+		struct dirent *entry;
+		while (NULL != (entry = readdir(dir))) {
+			if (entry->d_name[0] != '.') names.push_back(entry->d_name);
+		}
+		closedir(dir);
+
+		std::sort(names.begin(),names.end());
+
+		std::string prefix = path;
+		if (prefix[prefix.size()-1] != '/') prefix += '/';
+		std::vector<std::string>::iterator it;
+		for (it = names.begin(); it != names.end(); ++it) {
+			addInput(prefix + *it,true);
+		}
+	} else if (S_ISREG(st.st_mode) || !inDirectory) {
+		Inputs.push_back(path);
+	}
 }
 
 static void parseCommandLine(int argc, const char *argv[])
 {
 	int pos = 1;
 
+	if ((argc > 1) && !strcmp("merge",argv[1])) {
+		Merge = true;
+		++pos;
+	}
+
 	while (pos < argc) {
 		const char *str = argv[pos++];
 
-		if (InFile == NULL) {
-			InFile = str;
-		} else if (OutFile == NULL) {
-			OutFile = str;
+		if (*str == '-') {
+			if (!strcmp("-strict",str)) {
+				Strict = true;
+			} else if (!strcmp("-ndjson",str)) {
+				NDJSON = true;
+			} else if (!strcmp("-threads",str)) {
+				if (pos >= argc) {
+					fprintf(stderr,"Missing parameter\n");
+					exit(1);
+				}
+				Threads = atoi(argv[pos++]);
+			} else if (!strcmp("-snapshot",str)) {
+				if (pos >= argc) {
+					fprintf(stderr,"Missing parameter\n");
+					exit(1);
+				}
+				SnapshotFile = argv[pos++];
+			} else if (!strcmp("-state",str)) {
+				if (pos >= argc) {
+					fprintf(stderr,"Missing parameter\n");
+					exit(1);
+				}
+				StateFile = argv[pos++];
+			} else if (!strcmp("-sample",str)) {
+				if (pos >= argc) {
+					fprintf(stderr,"Missing parameter\n");
+					exit(1);
+				}
+				Fraction = atof(argv[pos++]);
+				if ((Fraction <= 0) || (Fraction > 1)) {
+					fprintf(stderr,"Sample must be greater than 0 and at most 1\n");
+					exit(1);
+				}
+			} else if (!strcmp("-arraylimit",str)) {
+				if (pos >= argc) {
+					fprintf(stderr,"Missing parameter\n");
+					exit(1);
+				}
+				ArrayLimit = (uint32_t)atoi(argv[pos++]);
+			} else if (!strcmp("-converge",str)) {
+				if (pos >= argc) {
+					fprintf(stderr,"Missing parameter\n");
+					exit(1);
+				}
+				Converge = (uint32_t)atoi(argv[pos++]);
+			} else if (!strcmp("-dom",str)) {
+				if (pos >= argc) {
+					fprintf(stderr,"Missing parameter\n");
+					exit(1);
+				}
+				str = argv[pos++];
+				if (!strcmp("tree",str)) {
+					DOM = DOM_TREE;
+				} else if (!strcmp("arena",str)) {
+					DOM = DOM_ARENA;
+				} else if (!strcmp("tape",str)) {
+					DOM = DOM_TAPE;
+				} else {
+					fprintf(stderr,"Illegal parameter %s\n",str);
+					exit(1);
+				}
+			} else {
+				fprintf(stderr,"Illegal parameter %s\n",str);
+				exit(1);
+			}
 		} else {
-			fprintf(stderr,"Improper arguments");
-			exit(-1);
+			Files.push_back(str);
 		}
 	}
 
-	if (OutFile == NULL) {
+	if ((DOM != DOM_NONE) && (ArrayLimit > 0)) {
+		fprintf(stderr,"-arraylimit cannot be used with -dom\n");
+		exit(1);
+	}
+
+	if (Merge) {
+		if (Files.size() < 2) {
+			fprintf(stderr,"Insufficient arguments");
+			exit(-1);
+		}
+	} else if (Files.size() == 1) {
 		fprintf(stderr,"Insufficient arguments");
 		exit(-1);
+	} else {
+		for (size_t i = 0; i + 1 < Files.size(); ++i) {
+			addInput(Files[i],false);
+		}
 	}
 }
 
 int main(int argc, const char * argv[])
 {
-	if (argc == 1) {
-		runAnalysis(stdin, stdout);
+	parseCommandLine(argc, argv);
+
+	if (Merge) {
+		FILE *out = fopen(Files.back(),"w");
+		if (out == NULL) {
+			fprintf(stderr,"Unable to write %s",Files.back());
+			exit(-1);
+		}
+
+		runMerge(out);
 		return 0;
 	}
 
-	parseCommandLine(argc, argv);
+	if (Files.empty()) {
+		runAnalysis(stdin, stdout);
+		return 0;
+	}
 
-	FILE *in = fopen(InFile,"r");
-	if (in == NULL) {
-		fprintf(stderr,"Unable to read %s",InFile);
+	if (Inputs.empty()) {
+		fprintf(stderr,"No input files\n");
 		exit(-1);
 	}
 
-	FILE *out = fopen(OutFile,"w");
+	FILE *in = NULL;
+	if (Inputs.size() == 1) {
+		in = fopen(Inputs[0].c_str(),"r");
+		if (in == NULL) {
+			fprintf(stderr,"Unable to read %s",Inputs[0].c_str());
+			exit(-1);
+		}
+	}
+
+	FILE *out = fopen(Files.back(),"w");
 	if (out == NULL) {
-		fprintf(stderr,"Unable to write %s",OutFile);
+		fprintf(stderr,"Unable to write %s",Files.back());
 		exit(-1);
 	}
 
-	runAnalysis(in, out);
+	if (in) {
+		runAnalysis(in, out);
+	} else {
+		runFiles(out);
+	}
 
 	return 0;
 }
@@ -0,0 +1,274 @@
+//
+//  JSDecompressInputStream.cpp
+//  AnalyzeJSON
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#include "JSInputStream.h"
+#include <string.h>
+#include <zlib.h>
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+/************************************************************************/
+/*																		*/
+/*	Construction/Destruction											*/
+/*																		*/
+/************************************************************************/
+
+/*	JSDecompressInputStream::JSDecompressInputStream
+ *
+ *		Construct me with the compressed stream, and start decompressing
+ */
+
+JSDecompressInputStream::JSDecompressInputStream(ref<JSInputStream> is, int f)
+{
+	input = is;
+	format = f;
+	start();
+}
+
+/*	JSDecompressInputStream::~JSDecompressInputStream
+ *
+ *		Destroy me
+ */
+
+JSDecompressInputStream::~JSDecompressInputStream()
+{
+	finish();
+}
+
+/*	JSDecompressInputStream::cancel
+ *
+ *		Stop, and stop the stream we read from as well, as the thread may be
+ *	waiting on it
+ */
+
+void JSDecompressInputStream::cancel()
+{
+	JSThreadInputStream::cancel();
+	input->cancel();
+}
+
+/************************************************************************/
+/*																		*/
+/*	Decompression														*/
+/*																		*/
+/************************************************************************/
+
+/*	JSDecompressInputStream::produce
+ *
+ *		Thread entry point
+ */
+
+void JSDecompressInputStream::produce()
+{
+	if (format == JSCOMPRESS_GZIP) {
+		inflateGzip();
+	} else {
+		decompressZstd();
+	}
+}
+
+/*	JSDecompressInputStream::inflateGzip
+ *
+ *		Decompress gzip. A file can hold several gzip members one after
+ *	another, as from cat a.gz b.gz; these are read as one. Anything after
+ *	the last member is skipped, as gzip does.
+ *
+ *		Output is handed over before waiting for more input, so a reader
+ *	on a pipe sees each piece as soon as it arrives
+ */
+
+void JSDecompressInputStream::inflateGzip()
+{
+	z_stream z;
+	memset(&z,0,sizeof(z));
+	if (Z_OK != inflateInit2(&z,15 + 16)) {		/* gzip header only */
+		error = "Unable to decompress the input";
+		return;
+	}
+
+	const uint8_t *in = NULL;
+	size_t inLen = 0;
+	bool member = true;							/* In a gzip member */
+	bool progress = true;
+
+	while (progress && error.empty()) {
+		if (!member) {
+			if (inLen == 0) inLen = input->peekBlock(&in);
+			if (inLen == 0) break;
+			if ((in[0] != 0x1F) || ((inLen > 1) && (in[1] != 0x8B))) {
+				skipTrailing(in,inLen);
+				break;
+			}
+			inflateReset(&z);
+			member = true;
+		}
+
+		uint8_t *out = nextBlock();
+		if (out == NULL) break;
+
+		z.next_out = out;
+		z.avail_out = THREADBLOCKSIZE;
+
+		/*
+		 *	Inflate is called even with no input left, as it may still
+		 *	hold output. Only once it is stuck do we wait for more input;
+		 *	if there is none the input was cut short
+		 */
+
+		while (z.avail_out > 0) {
+			uInt chunk = (inLen > 0x40000000) ? 0x40000000 : (uInt)inLen;
+			uInt space = z.avail_out;
+			z.next_in = (Bytef *)in;
+			z.avail_in = chunk;
+
+			int ret = inflate(&z,Z_NO_FLUSH);
+
+			size_t used = chunk - z.avail_in;
+			input->skipBlock(used);
+			in += used;
+			inLen -= used;
+
+			if (ret == Z_STREAM_END) {
+				member = false;
+				break;
+			} else if (ret == Z_BUF_ERROR) {
+				if ((used == 0) && (space == z.avail_out)) {
+					if (z.avail_out < THREADBLOCKSIZE) break;
+					if (inLen == 0) inLen = input->peekBlock(&in);
+					if (inLen == 0) {
+						progress = false;
+						break;
+					}
+				}
+			} else if (ret != Z_OK) {
+				error = "The compressed input is damaged";
+				break;
+			}
+		}
+
+		putBlock(THREADBLOCKSIZE - z.avail_out);
+	}
+
+	if (!progress) error = "The compressed input is incomplete";
+
+	inflateEnd(&z);
+}
+
+/*	JSDecompressInputStream::skipTrailing
+ *
+ *		Skip what follows the last gzip member. Tapes and some tools pad
+ *	the file with zeros, which are passed over quietly; anything else is
+ *	noted, but what was decompressed is still used
+ */
+
+void JSDecompressInputStream::skipTrailing(const uint8_t *in, size_t inLen)
+{
+	bool zeros = true;
+
+	while (inLen > 0) {
+		for (size_t i = 0; zeros && (i < inLen); ++i) {
+			if (in[i] != 0) zeros = false;
+		}
+		input->skipBlock(inLen);
+		inLen = input->peekBlock(&in);
+	}
+
+	if (!zeros) error = "Ignoring data after the compressed input";
+}
+
+/*	JSDecompressInputStream::decompressZstd
+ *
+ *		Decompress zstd. Like gzip, several frames in a row are read as one,
+ *	and output is handed over before waiting for more input
+ */
+
+void JSDecompressInputStream::decompressZstd()
+{
+#ifdef HAVE_ZSTD
+	ZSTD_DStream *z = ZSTD_createDStream();
+	if ((z == NULL) || ZSTD_isError(ZSTD_initDStream(z))) {
+		error = "Unable to decompress the input";
+		if (z) ZSTD_freeDStream(z);
+		return;
+	}
+
+	const uint8_t *in = NULL;
+	size_t inLen = 0;
+	size_t hint = 1;							/* 0 at the end of a frame */
+	bool progress = true;
+
+	while (progress && error.empty()) {
+		if (hint == 0) {
+			if (inLen == 0) inLen = input->peekBlock(&in);
+			if (inLen == 0) break;
+		}
+
+		uint8_t *out = nextBlock();
+		if (out == NULL) break;
+
+		ZSTD_outBuffer zout = { out, THREADBLOCKSIZE, 0 };
+
+		while (zout.pos < zout.size) {
+			ZSTD_inBuffer zin = { in, inLen, 0 };
+			size_t before = zout.pos;
+
+			hint = ZSTD_decompressStream(z,&zout,&zin);
+			if (ZSTD_isError(hint)) {
+				error = "The compressed input is damaged";
+				break;
+			}
+
+			input->skipBlock(zin.pos);
+			in += zin.pos;
+			inLen -= zin.pos;
+
+			if ((hint == 0) && (inLen == 0)) break;
+			if ((zin.pos == 0) && (zout.pos == before)) {
+				if (zout.pos > 0) break;
+				if (inLen == 0) inLen = input->peekBlock(&in);
+				if (inLen == 0) {
+					progress = false;
+					break;
+				}
+			}
+		}
+
+		putBlock(zout.pos);
+	}
+
+	if (!progress) error = "The compressed input is incomplete";
+
+	ZSTD_freeDStream(z);
+#else
+	error = "zstd compressed input is not supported";
+#endif
+}
+
+/************************************************************************/
+/*																		*/
+/*	Utilities															*/
+/*																		*/
+/************************************************************************/
+
+/*	JSCompressedFormat
+ *
+ *		Look for the magic numbers at the start of gzip and zstd files
+ */
+
+int JSCompressedFormat(const uint8_t *data, size_t len)
+{
+	if ((len >= 2) && (data[0] == 0x1F) && (data[1] == 0x8B)) {
+		return JSCOMPRESS_GZIP;
+	}
+	if ((len >= 4) && (data[0] == 0x28) && (data[1] == 0xB5) && (data[2] == 0x2F) && (data[3] == 0xFD)) {
+		return JSCOMPRESS_ZSTD;
+	}
+	return JSCOMPRESS_NONE;
+}
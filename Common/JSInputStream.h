@@ -11,6 +11,10 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#include <string>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
 #include "JSObject.h"
 
 /************************************************************************/
@@ -20,6 +24,20 @@
 /************************************************************************/
 
 #define MAXPUSHBACK		16
+#define READBLOCKSIZE	65536
+
+#define THREADBLOCKSIZE	(1 << 20)
+#define THREADBLOCKS	4
+
+/*
+ *	Compressed formats, found from the first bytes of the input. zstd is
+ *	only read if built with HAVE_ZSTD and linked against libzstd, which
+ *	the Xcode project does with WITH_ZSTD=YES
+ */
+
+#define JSCOMPRESS_NONE		0
+#define JSCOMPRESS_GZIP		1
+#define JSCOMPRESS_ZSTD		2
 
 /************************************************************************/
 /*																		*/
@@ -29,59 +47,207 @@
 
 /*	JSInputStream
  *
- *		Input stream abstraction.
+ *		Input stream abstraction. Streams can be read a character at a
+ *	time, or a block at a time: peekBlock() returns the next contiguous
+ *	span of bytes without consuming them (0 at EOF), and skipBlock()
+ *	consumes some or all of the span last returned. The span remains
+ *	valid until the next call to peekBlock() or readNextChar().
+ *
+ *		cancel() tells a stream which reads ahead that nothing more will be
+ *	read from it, so it can stop waiting on its input.
  */
 
 class JSInputStream : public JSObject
 {
 	public:
-		virtual int32_t	readNextChar() = 0;	/* >= 0: UNICODE. -1: EOF */
+		virtual int32_t	readNextChar()		/* >= 0: UNICODE. -1: EOF */
+							{
+								const uint8_t *data;
+								if (0 == peekBlock(&data)) return -1;
+
+								int32_t ch = *data;
+								skipBlock(1);
+								return ch;
+							}
+
+		virtual size_t	peekBlock(const uint8_t **data) = 0;
+		virtual void	skipBlock(size_t len) = 0;
+
+		virtual void	cancel()
+							{
+							}
 };
 
-/*	JSBufferedInputStream
+/*	JSMappedInputStream
  *
- *		Handle a push back buffer. Wraps an input stream to provide push
- *	back functionality
+ *		Memory mapped file reader. The entire file is mapped into memory
+ *	and characters are served directly out of the mapping.
  */
 
-class JSBufferedInputStream : public JSInputStream
+class JSMappedInputStream : public JSInputStream
 {
 	public:
-							JSBufferedInputStream(ref<JSInputStream> is);
-							~JSBufferedInputStream();
+							JSMappedInputStream(FILE *f, const uint8_t *data, size_t size, size_t pos);
+		virtual				~JSMappedInputStream();
 
-		int					readNextChar();
-		void				pushBackChar(int32_t ch);
+		virtual int			readNextChar();
 
-		int					getCurLine()
-								{
-									return curLine;
-								}
+		virtual size_t		peekBlock(const uint8_t **data);
+		virtual void		skipBlock(size_t len);
 
 	private:
-		int32_t				curLine;
-
-		uint16_t			index;
-		int					buffer[MAXPUSHBACK];
-		ref<JSInputStream>	input;
+		FILE				*file;
+		const uint8_t		*data;
+		size_t				size;
+		size_t				pos;
 };
 
-/*	JSFileInputStream
+/*	JSMemoryInputStream
  *
- *		Basic file reader
+ *		Reads from a range of memory owned by someone else, such as a
+ *	section of a mapped file. The memory must outlive the stream.
  */
 
-class JSFileInputStream : public JSInputStream
+class JSMemoryInputStream : public JSInputStream
 {
 	public:
-							JSFileInputStream(FILE *f);
-		virtual				~JSFileInputStream();
+							JSMemoryInputStream(const uint8_t *data, size_t size);
+		virtual				~JSMemoryInputStream();
 
 		virtual int			readNextChar();
 
+		virtual size_t		peekBlock(const uint8_t **data);
+		virtual void		skipBlock(size_t len);
+
+	private:
+		const uint8_t		*data;
+		size_t				size;
+		size_t				pos;
+};
+
+/*	JSThreadInputStream
+ *
+ *		A stream whose data is produced on a thread of its own, which fills
+ *	a ring of large blocks ahead of the reader; the blocks are handed out
+ *	by peekBlock() without copying. Subclasses implement produce(), which
+ *	fills blocks from nextBlock() and hands them over with putBlock(). They
+ *	call start() once constructed, and finish() first thing when destroyed
+ *	so the thread is done with them. A subclass whose thread can wait on
+ *	something other than the ring overrides cancel() to wake it.
+ *
+ *		An error set by produce() is written to stderr when the reader gets
+ *	to the end of the stream.
+ */
+
+class JSThreadInputStream : public JSInputStream
+{
+	public:
+							JSThreadInputStream();
+		virtual				~JSThreadInputStream();
+
+		virtual size_t		peekBlock(const uint8_t **data);
+		virtual void		skipBlock(size_t len);
+		virtual void		cancel();
+
+	protected:
+		std::string			error;
+
+		void				start();
+		void				finish();
+
+		uint8_t				*nextBlock();
+		void				putBlock(size_t len);
+
+		virtual void		produce() = 0;
+
+	private:
+		uint8_t				*blocks[THREADBLOCKS];
+		size_t				lengths[THREADBLOCKS];
+		uint64_t			head;			/* Blocks filled */
+		uint64_t			tail;			/* Blocks read */
+		bool				done;
+		bool				stop;
+		std::mutex			lock;
+		std::condition_variable changed;
+		std::thread			thread;
+
+		const uint8_t		*data;			/* Block being read */
+		size_t				pos;
+		size_t				length;
+		bool				holding;
+
+		void				run();
+};
+
+/*	JSReadAheadInputStream
+ *
+ *		Reads a file on a thread, so the reader is not kept waiting on a
+ *	slow disk, network share or pipe. Whatever has arrived is handed over
+ *	without waiting for a block to fill, and the thread only reads once
+ *	there is input, so it can be stopped while a pipe is quiet.
+ */
+
+class JSReadAheadInputStream : public JSThreadInputStream
+{
+	public:
+							JSReadAheadInputStream(FILE *f);
+		virtual				~JSReadAheadInputStream();
+
+		void				cancel();
+
 	private:
-		int32_t				readUTFBytes(int start, int num);
 		FILE				*file;
+		int					wake[2];		/* Pipe written to by cancel() */
+
+		int					waitInput(bool block);
+		void				produce();
 };
 
+/*	JSDecompressInputStream
+ *
+ *		Decompresses another stream as it is read, on a thread. Damaged or
+ *	truncated input ends the stream early.
+ */
+
+class JSDecompressInputStream : public JSThreadInputStream
+{
+	public:
+							JSDecompressInputStream(ref<JSInputStream> is, int format);
+		virtual				~JSDecompressInputStream();
+
+		void				cancel();
+
+	private:
+		ref<JSInputStream>	input;			/* Read only by the thread */
+		int					format;
+
+		void				produce();
+		void				inflateGzip();
+		void				skipTrailing(const uint8_t *in, size_t inLen);
+		void				decompressZstd();
+};
+
+/************************************************************************/
+/*																		*/
+/*	Utilities															*/
+/*																		*/
+/************************************************************************/
+
+/*	JSOpenInputStream
+ *
+ *		Construct the best input stream for the file. Regular files are
+ *	memory mapped; pipes and terminals are read ahead on a thread.
+ *	Compressed input is decompressed as it is read. The returned stream
+ *	takes ownership of the file.
+ */
+
+extern ref<JSInputStream> JSOpenInputStream(FILE *f);
+
+/*	JSCompressedFormat
+ *
+ *		The compressed format the data starts with, or JSCOMPRESS_NONE
+ */
+
+extern int JSCompressedFormat(const uint8_t *data, size_t len);
+
 #endif
@@ -8,7 +8,9 @@
 
 #include "JSLex.h"
 #include "JSUtils.h"
+#include "JSScan.h"
 #include <ctype.h>
+#include <string.h>
 
 /************************************************************************/
 /*																		*/
@@ -16,6 +18,13 @@
 /*																		*/
 /************************************************************************/
 
+/*	JSLexInternal
+ *
+ *		Keyword table entry. Keywords are stored in an open addressed hash
+ *	table; the constructor picks a hash seed so that no two keywords share
+ *	a slot, so a lookup is one hash and at most one compare.
+ */
+
 struct JSLexInternal
 {
 	std::string match;
@@ -28,13 +37,23 @@ struct JSLexInternal
 /*																		*/
 /************************************************************************/
 
-static JSLexInternal *Find(JSLexInternal *array, int max, std::string &str)
+/*	KeywordHash
+ *
+ *		Hash from the length and the first, middle and last characters.
+ *	Does not touch the heap.
+ */
+
+static inline uint32_t KeywordHash(const char *str, size_t len, uint32_t seed)
 {
-	for (int i = 0; i < max; ++i) {
-		JSLexInternal *ptr = array + i;
-		if (ptr->match == str) return ptr;
-	}
-	return NULL;
+	uint32_t h = seed ^ ((uint32_t)len * 0x9E3779B1U);
+
+	h ^= (uint8_t)str[0] * 0x85EBCA77U;
+	h ^= (uint8_t)str[len/2] * 0xC2B2AE3DU;
+	h ^= (uint8_t)str[len-1] * 0x27D4EB2FU;
+	h ^= h >> 15;
+	h *= 0x2C1B3C6DU;
+	h ^= h >> 13;
+	return h;
 }
 
 
@@ -57,28 +76,72 @@ static int FromXDigit(int32_t ch)
  *		Construct this with quick lookup of strings
  */
 
-JSLex::JSLex(ref<JSInputStream> i, const char * const reserved[])
+JSLex::JSLex(ref<JSInputStream> i, const char * const reserved[], bool s)
 {
-	sc = new JSStripComment(i);
-	input = new JSBufferedInputStream(sc.get());
+	input = i;
+	strict = s;
 
 	pushFlag = false;
 	lastRead = 0;
+	lastLine = 0;
+
+	start = NULL;
+	cur = NULL;
+	end = NULL;
+	pushIndex = 0;
+	curLine = 0;
 
 	offset = 0;
 	length = 256;
 	text = new char[length];
+	tokenData = NULL;
+	tokenLength = 0;
+	numberValid = false;
+
+	/*
+	 *	Build the keyword table. We search for a seed which puts every
+	 *	keyword in its own slot, growing the table if we can't find one.
+	 *	Should that fail (keywords which agree on every character hashed)
+	 *	lookups still work, just with an extra probe.
+	 */
 
 	int ct = 0;
 	for (const char * const *ptr = reserved; *ptr; ptr++) {
 		++ct;
 	}
-	
-	max = ct;
-	keywords = new JSLexInternal[ct];
+
+	uint32_t size = 4;
+	while (size < (uint32_t)ct * 2) size <<= 1;
+
+	keywords = NULL;
+	for (int attempt = 0; (attempt < 4) && (keywords == NULL); ++attempt, size <<= 1) {
+		bool *used = new bool[size];
+		for (seed = 1; seed < 1024; ++seed) {
+			memset(used,0,size * sizeof(bool));
+
+			int i;
+			for (i = 0; i < ct; ++i) {
+				uint32_t index = KeywordHash(reserved[i],strlen(reserved[i]),seed) & (size - 1);
+				if (used[index]) break;
+				used[index] = true;
+			}
+			if (i == ct) break;
+		}
+		delete[] used;
+
+		if ((seed < 1024) || (attempt == 3)) {
+			mask = size - 1;
+			keywords = new JSLexInternal[size];
+		}
+	}
+	if (seed >= 1024) seed = 0;
+
 	for (int i = 0; i < ct; ++i) {
-		keywords[i].match = reserved[i];
-		keywords[i].val = SYMBOL_RESERVED + i;
+		uint32_t index = KeywordHash(reserved[i],strlen(reserved[i]),seed) & mask;
+		while (!keywords[index].match.empty()) index = (index + 1) & mask;
+
+		keywords[index].match = reserved[i];
+		keywords[index].val = SYMBOL_RESERVED + i;
 	}
 }
 
@@ -102,9 +165,9 @@ JSLex::~JSLex()
 void JSLex::append(uint16_t ch)
 {
 	if (offset >= length) {
-		int newsize = (length * 4) / 3;
+		size_t newsize = (length * 4) / 3;
 		char *newPtr = new char[newsize];
-		memmove(newPtr, text, offset * sizeof(uint16_t));
+		memmove(newPtr, text, offset);
 
 		char *oldPtr = text;
 		text = newPtr;
@@ -116,6 +179,140 @@ void JSLex::append(uint16_t ch)
 	text[offset++] = ch;
 }
 
+/*	JSLex::append
+ *
+ *		Append a run of characters to the internal buffer
+ */
+
+void JSLex::append(const uint8_t *data, size_t len)
+{
+	if (offset + len > length) {
+		size_t newsize = ((offset + len) * 4) / 3;
+		char *newPtr = new char[newsize];
+		memmove(newPtr, text, offset);
+
+		char *oldPtr = text;
+		text = newPtr;
+		delete[] oldPtr;
+
+		length = newsize;
+	}
+
+	memmove(text + offset, data, len);
+	offset += len;
+}
+
+/*	JSLex::fillBuffer
+ *
+ *		Called when we've exhausted the current block. Consume the block
+ *	and fetch the next one, returning the first character or -1 at EOF
+ */
+
+int32_t JSLex::fillBuffer()
+{
+	const uint8_t *data = NULL;
+
+	input->skipBlock(end - start);
+	size_t len = input->peekBlock(&data);
+	if (len == 0) {
+		start = cur = end = NULL;
+		return -1;
+	}
+
+	start = data;
+	end = data + len;
+	cur = start + 1;
+	return *start;
+}
+
+/*	JSLex::skipLineComment
+ *
+ *		Called after reading '//'. Skip to '\n', '\r' or EOF, leaving the
+ *	line terminator to be read as whitespace
+ */
+
+void JSLex::skipLineComment()
+{
+	for (;;) {
+		while ((pushIndex == 0) && (cur < end)) {
+			if ((*cur == '\n') || (*cur == '\r')) return;
+			++cur;
+		}
+
+		int32_t c = readChar();
+		if (c == -1) return;
+		if ((c == '\n') || (c == '\r')) {
+			pushBackChar(c);
+			return;
+		}
+	}
+}
+
+/*	JSLex::skipBlockComment
+ *
+ *		Called after reading the opening of a block comment. Skip past the
+ *	closing star-slash; returns false if we hit EOF first. Newlines inside
+ *	the comment are counted, so the lines reported after it are the lines
+ *	in the file.
+ */
+
+bool JSLex::skipBlockComment()
+{
+	bool star = false;
+
+	for (;;) {
+		int32_t c = readChar();
+		if (c == -1) return false;
+		if (star && (c == '/')) return true;
+		star = (c == '*');
+	}
+}
+
+/*	JSLex::skipLine
+ *
+ *		Skip the rest of the current line, including the '\n'. Returns
+ *	false if we hit EOF first. A token pushed back is dropped.
+ */
+
+bool JSLex::skipLine()
+{
+	pushFlag = false;
+
+	for (;;) {
+		if ((pushIndex == 0) && (cur < end)) {
+			const uint8_t *nl = (const uint8_t *)memchr(cur,'\n',end - cur);
+			if (nl) {
+				cur = nl + 1;
+				++curLine;
+				return true;
+			}
+			cur = end;
+		}
+
+		int32_t c = readChar();
+		if (c == -1) return false;
+		if (c == '\n') return true;
+	}
+}
+
+/*	JSLex::findKeyword
+ *
+ *		Return the reserved word token for the identifier, or SYMBOL_TOKEN
+ *	if this is not a reserved word
+ */
+
+int32_t JSLex::findKeyword(const char *str, size_t len)
+{
+	uint32_t index = KeywordHash(str,len,seed) & mask;
+
+	for (;;) {
+		JSLexInternal *ptr = keywords + index;
+		if (ptr->match.empty()) return SYMBOL_TOKEN;
+		if ((ptr->match.size() == len) && !memcmp(ptr->match.data(),str,len)) return ptr->val;
+		index = (index + 1) & mask;
+	}
+}
+
 /************************************************************************/
 /*																		*/
 /*	Tokenization														*/
@@ -137,12 +334,34 @@ int32_t JSLex::nextToken()
 
 	int32_t c;
 
-	do {
-		c = input->readNextChar();
-	} while (isspace(c));
+	/*
+	 *	Skip whitespace and comments
+	 */
+
+	for (;;) {
+		if (pushIndex == 0) cur = JSSkipWhitespace(cur,end,&curLine);
+		c = readChar();
+		if (isspace(c)) continue;
+		if ((c != '/') || strict) break;
+
+		int32_t d = readChar();
+		if (d == '/') {
+			skipLineComment();
+		} else if (d == '*') {
+			if (!skipBlockComment()) {
+				c = -1;				/* Unterminated comment runs to EOF */
+				break;
+			}
+		} else {
+			pushBackChar(d);
+			break;
+		}
+	}
 	offset = 0;
+	tokenData = NULL;
+	numberValid = false;
 
-	lastLine = sc->getCurLine();	/* Get current line in underlying buffer */
+	lastLine = curLine;						/* Line of first character */
 	if (c == -1) return lastRead = -1;		/* EOF */
 
 	/*
@@ -152,22 +371,15 @@ int32_t JSLex::nextToken()
 	if (isalpha(c) || (c == '_') || (c == '$')) {
 		while (isalnum(c) || (c == '_') || (c == '$')) {
 			append(c);
-			c = input->readNextChar();
+			c = readChar();
 		}
-		input->pushBackChar(c);
+		pushBackChar(c);
 
 		/*
 		 *	We have a token. Now determine if it is a reserved keyword
 		 */
 
-		std::string str(text,offset);
-		JSLexInternal *k = Find(keywords,max,str);
-
-		if (k) {
-			return lastRead = k->val;
-		} else {
-			return lastRead = SYMBOL_TOKEN;
-		}
+		return lastRead = findKeyword(text,offset);
 	}
 
 	/*
@@ -175,19 +387,43 @@ int32_t JSLex::nextToken()
 	 */
 
 	if (c == '"') {
-		sc->disableStripComment();
+		/*
+		 *	If the whole string sits in the current block with no escapes,
+		 *	hand back the text in place rather than copying it
+		 */
+
+		if (pushIndex == 0) {
+			const uint8_t *ptr = JSScanString(cur,end);
+			if ((ptr < end) && (*ptr == '"')) {
+				tokenData = (const char *)cur;
+				tokenLength = ptr - cur;
+				cur = ptr + 1;
+
+				return lastRead = SYMBOL_STRING;
+			}
+		}
 
 		/*
 		 *	This will also convert a string containing string escapes
 		 */
 
 		for (;;) {
-			c = input->readNextChar();
+			/*
+			 *	Copy the run of ordinary characters in one go
+			 */
+
+			if (pushIndex == 0) {
+				const uint8_t *ptr = JSScanString(cur,end);
+				append(cur, ptr - cur);
+				cur = ptr;
+			}
+
+			c = readChar();
 
 			if (c == '"') break;
 			if (c == -1) return lastRead = -1;
 			if (c == '\\') {
-				c = input->readNextChar();
+				c = readChar();
 				if (c == 'b') {
 					append('\b');
 				} else if (c == 'f') {
@@ -205,11 +441,11 @@ int32_t JSLex::nextToken()
 
 					uint16_t tmp = 0;
 					for (int i = 0; i < 4; ++i) {
-						c = input->readNextChar();
+						c = readChar();
 						if (isxdigit(c)) {
 							tmp = (tmp << 4) | FromXDigit(c);
 						} else {
-							input->pushBackChar(c);
+							pushBackChar(c);
 							break;
 						}
 					}
@@ -222,8 +458,6 @@ int32_t JSLex::nextToken()
 			}
 		}
 
-		sc->enableStripComment();
-
 		return lastRead = SYMBOL_STRING;
 	}
 
@@ -235,10 +469,10 @@ int32_t JSLex::nextToken()
 	if (isdigit(c)) number = true;
 	if (c == '-') {
 		append(c);
-		c = input->readNextChar();
+		c = readChar();
 		if (isdigit(c)) number = true;
 		else {
-			input->pushBackChar(c);
+			pushBackChar(c);
 			return lastRead = '-';
 		}
 	}
@@ -248,27 +482,27 @@ int32_t JSLex::nextToken()
 		if (c != '0') {
 			while (isdigit(c)) {
 				append(c);
-				c = input->readNextChar();
+				c = readChar();
 			}
 		} else {
 			append(c);
-			c = input->readNextChar();
+			c = readChar();
 		}
 
 		if (c == '.') {
 			append(c);
 			real = true;
 			for (;;) {
-				c = input->readNextChar();
+				c = readChar();
 				if (isdigit(c)) append(c);
 				else break;
 			}
 		}
 
 		if ((c == 'e') || (c == 'E')) {
-			uint32_t d = input->readNextChar();
+			uint32_t d = readChar();
 			if ((d == '+') || (d == '-')) {
-				uint32_t e = input->readNextChar();
+				uint32_t e = readChar();
 				if (isdigit(e)) {
 					real = true;
 					append(c);
@@ -276,11 +510,11 @@ int32_t JSLex::nextToken()
 					c = e;
 					while (isdigit(c)) {
 						append(c);
-						c = input->readNextChar();
+						c = readChar();
 					}
 				} else {
-					input->pushBackChar(e);
-					input->pushBackChar(d);
+					pushBackChar(e);
+					pushBackChar(d);
 				}
 			} else if (isdigit(d)) {
 				real = true;
@@ -288,14 +522,14 @@ int32_t JSLex::nextToken()
 				c = d;
 				while (isdigit(c)) {
 					append(c);
-					c = input->readNextChar();
+					c = readChar();
 				}
 			} else {
-				input->pushBackChar(d);
+				pushBackChar(d);
 			}
 		}
 
-		input->pushBackChar(c);
+		pushBackChar(c);
 
 		return lastRead = real ? SYMBOL_REAL : SYMBOL_INTEGER;
 	}
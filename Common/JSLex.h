@@ -10,47 +10,9 @@
 #define __AnalyzeJSON__JSLex__
 
 #include "JSInputStream.h"
+#include "JSNumber.h"
 #include <string>
 
-/************************************************************************/
-/*																		*/
-/*	Preprocessor														*/
-/*																		*/
-/************************************************************************/
-
-/*	JSStripComment
- *
- *		Input stream which strips comments out
- */
-
-class JSStripComment : public JSInputStream
-{
-	public:
-					JSStripComment(ref<JSInputStream> is);
-					~JSStripComment();
-
-		int			readNextChar();
-
-		void		enableStripComment()
-						{
-							stripFlag = true;
-						}
-
-		void		disableStripComment()
-						{
-							stripFlag = false;
-						}
-
-		int			getCurLine()
-						{
-							return input->getCurLine();
-						}
-
-	private:
-		bool		stripFlag;
-		ref<JSBufferedInputStream> input;
-};
-
 /************************************************************************/
 /*																		*/
 /*	Lexical Parser														*/
@@ -67,16 +29,41 @@ class JSStripComment : public JSInputStream
 #define SYMBOL_REAL		0x10003
 #define SYMBOL_RESERVED	0x10004		/* First reserved word token */
 
+/*	JSToken
+ *
+ *		The text of the current token. This is not a copy: it points either
+ *	into the block being scanned, or into the lexer's scratch buffer if the
+ *	token had to be unescaped or crossed a block boundary. It is only valid
+ *	until the next call to nextToken(), so copy it if it needs to be kept.
+ */
+
+struct JSToken
+{
+	const char	*data;
+	size_t		length;
+
+	std::string	str() const
+					{
+						return std::string(data,length);
+					}
+};
+
 /*	JSLex
  *
  *		This takes an input stream and pulls apart the file into separate
- *	tokens. 
+ *	tokens. The lexer scans directly over the blocks returned by the
+ *	underlying stream, and only goes back to the stream when the current
+ *	block is exhausted.
+ *
+ *		Comments (both // and block comments) are skipped along with the
+ *	whitespace between tokens. In strict mode comments are not recognized,
+ *	and '/' is returned as an ordinary character.
  */
 
 class JSLex : public JSObject
 {
 	public:
-					JSLex(ref<JSInputStream> input, const char * const reserved[]);
+					JSLex(ref<JSInputStream> input, const char * const reserved[], bool strict = false);
 					~JSLex();
 
 		int32_t		nextToken();
@@ -85,32 +72,115 @@ class JSLex : public JSObject
 							pushFlag = true;
 						}
 
+		bool		skipLine();
+
 		int32_t		getLine()
 						{
 							return lastLine+1;
 						}
 
+		JSToken		getToken()
+						{
+							JSToken t;
+							if (tokenData) {
+								t.data = tokenData;
+								t.length = tokenLength;
+							} else {
+								t.data = text;
+								t.length = offset;
+							}
+							return t;
+						}
+
 		std::string getTokenValue()
 						{
-							return std::string(text,offset);
+							return getToken().str();
+						}
+
+		/* The value of a SYMBOL_INTEGER or SYMBOL_REAL token. This is only
+		 * converted the first time it is asked for.
+		 */
+		const JSNumber &getNumber()
+						{
+							if (!numberValid) {
+								JSToken t = getToken();
+								JSParseNumber(t.data,t.length,&number);
+								numberValid = true;
+							}
+							return number;
 						}
 
 	private:
-		ref<JSStripComment> sc;
-		ref<JSBufferedInputStream> input;
+		ref<JSInputStream> input;
+		bool		strict;
 
 		bool		pushFlag;
 		int32_t		lastRead;
-		int16_t		lastLine;
+		int32_t		lastLine;
+
+		/*
+		 *	Current block being scanned, and the characters pushed back
+		 *	across a block boundary
+		 */
+
+		const uint8_t *start;
+		const uint8_t *cur;
+		const uint8_t *end;
+
+		int			pushIndex;
+		int32_t		pushBuffer[MAXPUSHBACK];
+		int32_t		curLine;
 
-		int			offset;
-		int			length;
+		int32_t		readChar()
+						{
+							int32_t ch;
+
+							if (pushIndex > 0) ch = pushBuffer[--pushIndex];
+							else if (cur < end) ch = *cur++;
+							else ch = fillBuffer();
+
+							if (ch == '\n') ++curLine;
+							return ch;
+						}
+
+		void		pushBackChar(int32_t ch)
+						{
+							/*
+							 *	Pushed back characters only go on the stack
+							 *	when we've backed up to the start of the block
+							 */
+
+							if (ch == '\n') --curLine;
+							if ((pushIndex == 0) && (cur > start)) {
+								--cur;
+							} else if (pushIndex < MAXPUSHBACK) {
+								pushBuffer[pushIndex++] = ch;
+							}
+						}
+
+		int32_t		fillBuffer();
+
+		void		skipLineComment();
+		bool		skipBlockComment();
+
+		size_t		offset;
+		size_t		length;
 		char		*text;
 
+		const char	*tokenData;			/* Token in place, or NULL if in text */
+		size_t		tokenLength;
+
+		JSNumber	number;
+		bool		numberValid;
+
 		void		append(uint16_t ch);
+		void		append(const uint8_t *data, size_t len);
 
-		int			max;
+		uint32_t	seed;
+		uint32_t	mask;
 		struct JSLexInternal *keywords;
+
+		int32_t		findKeyword(const char *str, size_t len);
 };
 
 
@@ -0,0 +1,109 @@
+//
+//  JSMappedInputStream.cpp
+//  AnalyzeJSON
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#include "JSInputStream.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/************************************************************************/
+/*																		*/
+/*	Construction/Destruction											*/
+/*																		*/
+/************************************************************************/
+
+/*	JSMappedInputStream::JSMappedInputStream
+ *
+ *		Construct me with the file and the mapping of that file. This will
+ *	take ownership of both; the mapping is released and the file is closed
+ *	when the stream is done. Reading starts at pos, the file position at
+ *	the time the file was mapped.
+ */
+
+JSMappedInputStream::JSMappedInputStream(FILE *f, const uint8_t *d, size_t s, size_t p)
+{
+	file = f;
+	data = d;
+	size = s;
+	pos = p;
+}
+
+/*	JSMappedInputStream::~JSMappedInputStream
+ *
+ *		Destroy me
+ */
+
+JSMappedInputStream::~JSMappedInputStream()
+{
+	munmap((void *)data,size);
+	fclose(file);
+}
+
+/************************************************************************/
+/*																		*/
+/*	Reader																*/
+/*																		*/
+/************************************************************************/
+
+int JSMappedInputStream::readNextChar()
+{
+	if (pos >= size) return -1;
+	return data[pos++];
+}
+
+size_t JSMappedInputStream::peekBlock(const uint8_t **ptr)
+{
+	*ptr = data + pos;
+	return size - pos;
+}
+
+void JSMappedInputStream::skipBlock(size_t len)
+{
+	pos += len;
+}
+
+/************************************************************************/
+/*																		*/
+/*	Utilities															*/
+/*																		*/
+/************************************************************************/
+
+/*	JSOpenInputStream
+ *
+ *		Map the file if it is a regular file. Anything else (a pipe, a
+ *	terminal, an empty file, or a file we fail to map) is read ahead on
+ *	a thread. Either is then wrapped to decompress it if it starts like a
+ *	compressed file.
+ */
+
+ref<JSInputStream> JSOpenInputStream(FILE *f)
+{
+	struct stat st;
+	int fd = fileno(f);
+	ref<JSInputStream> is;
+
+	if ((0 == fstat(fd,&st)) && S_ISREG(st.st_mode) && (st.st_size > 0)) {
+		off_t pos = lseek(fd,0,SEEK_CUR);
+		void *ptr = mmap(NULL,(size_t)st.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+
+		if ((pos >= 0) && (ptr != MAP_FAILED)) {
+			madvise(ptr,(size_t)st.st_size,MADV_SEQUENTIAL);
+			is = new JSMappedInputStream(f,(const uint8_t *)ptr,(size_t)st.st_size,(size_t)pos);
+		} else if (ptr != MAP_FAILED) {
+			munmap(ptr,(size_t)st.st_size);
+		}
+	}
+	if (is == NULL) is = new JSReadAheadInputStream(f);
+
+	const uint8_t *data;
+	size_t len = is->peekBlock(&data);
+	int format = JSCompressedFormat(data,len);
+	if (format != JSCOMPRESS_NONE) return new JSDecompressInputStream(is,format);
+
+	return is;
+}
@@ -0,0 +1,59 @@
+//
+//  JSMemoryInputStream.cpp
+//  AnalyzeJSON
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#include "JSInputStream.h"
+
+/************************************************************************/
+/*																		*/
+/*	Construction/Destruction											*/
+/*																		*/
+/************************************************************************/
+
+/*	JSMemoryInputStream::JSMemoryInputStream
+ *
+ *		Construct me with the range of memory to read
+ */
+
+JSMemoryInputStream::JSMemoryInputStream(const uint8_t *d, size_t s)
+{
+	data = d;
+	size = s;
+	pos = 0;
+}
+
+/*	JSMemoryInputStream::~JSMemoryInputStream
+ *
+ *		Destroy me. The memory is not ours to release
+ */
+
+JSMemoryInputStream::~JSMemoryInputStream()
+{
+}
+
+/************************************************************************/
+/*																		*/
+/*	Reader																*/
+/*																		*/
+/************************************************************************/
+
+int JSMemoryInputStream::readNextChar()
+{
+	if (pos >= size) return -1;
+	return data[pos++];
+}
+
+size_t JSMemoryInputStream::peekBlock(const uint8_t **ptr)
+{
+	*ptr = data + pos;
+	return size - pos;
+}
+
+void JSMemoryInputStream::skipBlock(size_t len)
+{
+	pos += len;
+}
@@ -0,0 +1,170 @@
+//
+//  JSNumber.cpp
+//  AnalyzeJSON
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#include "JSNumber.h"
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <string>
+
+/*
+ *	Powers of ten which are exact as doubles
+ */
+
+static const double Powers[] = {
+	1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+	1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+	1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+#define MAXPOWER		22
+#define MAXEXACT		((uint64_t)1 << 53)
+#define MAXDIGITS		19			/* Always fit in a uint64_t */
+#define MAXEXPONENT		100000		/* Past this it's zero or infinity */
+
+/*	SlowParse
+ *
+ *		Let the C library convert the text, which rounds correctly but
+ *	needs a terminated copy
+ */
+
+static double SlowParse(const char *text, size_t length)
+{
+	char buffer[64];
+
+	if (length < sizeof(buffer)) {
+		memcpy(buffer,text,length);
+		buffer[length] = 0;
+		return strtod(buffer,NULL);
+	} else {
+		std::string str(text,length);
+		return strtod(str.c_str(),NULL);
+	}
+}
+
+/*	JSParseNumber
+ *
+ *		Integers are converted exactly. Reals whose digits fit in 53 bits
+ *	and whose power of ten is exact as a double are converted with one
+ *	multiply or divide, which rounds correctly (Clinger's fast path); the
+ *	rest go to strtod.
+ */
+
+void JSParseNumber(const char *text, size_t length, JSNumber *number)
+{
+	const char *ptr = text;
+	const char *end = text + length;
+	bool neg = false;
+
+	if ((ptr < end) && (*ptr == '-')) {
+		neg = true;
+		++ptr;
+	}
+
+	/*
+	 *	Integer part. This is gathered both exactly, noting overflow, and
+	 *	as the leading digits for a real
+	 */
+
+	uint64_t whole = 0;
+	bool overflow = false;
+	uint64_t mantissa = 0;
+	int digits = 0;
+	int64_t exp10 = 0;
+	bool truncated = false;
+
+	while ((ptr < end) && isdigit(*ptr)) {
+		uint32_t d = *ptr++ - '0';
+
+		if (!overflow) {
+			if (whole > (UINT64_MAX - d) / 10) overflow = true;
+			else whole = whole * 10 + d;
+		}
+
+		if (digits < MAXDIGITS) {
+			mantissa = mantissa * 10 + d;
+			if (mantissa) ++digits;
+		} else {
+			++exp10;
+			if (d) truncated = true;
+		}
+	}
+
+	if (ptr == end) {
+		if (overflow) {
+			number->type = JSNUMBER_BIGINTEGER;
+			number->integer = 0;
+			number->real = SlowParse(text,length);
+		} else if (neg) {
+			if (whole <= (uint64_t)INT64_MAX + 1) {
+				number->type = JSNUMBER_INTEGER;
+				number->integer = (int64_t)(0 - whole);
+			} else {
+				number->type = JSNUMBER_BIGINTEGER;
+				number->integer = 0;
+			}
+			number->real = -(double)whole;
+		} else if (whole <= (uint64_t)INT64_MAX) {
+			number->type = JSNUMBER_INTEGER;
+			number->integer = (int64_t)whole;
+			number->real = (double)whole;
+		} else {
+			number->type = JSNUMBER_UNSIGNED;
+			number->uinteger = whole;
+			number->real = (double)whole;
+		}
+		return;
+	}
+
+	/*
+	 *	Fraction and exponent
+	 */
+
+	if (*ptr == '.') {
+		++ptr;
+		while ((ptr < end) && isdigit(*ptr)) {
+			uint32_t d = *ptr++ - '0';
+
+			if (digits < MAXDIGITS) {
+				mantissa = mantissa * 10 + d;
+				if (mantissa) ++digits;
+				--exp10;
+			} else if (d) {
+				truncated = true;
+			}
+		}
+	}
+
+	if ((ptr < end) && ((*ptr == 'e') || (*ptr == 'E'))) {
+		bool eneg = false;
+		int64_t e = 0;
+
+		++ptr;
+		if ((ptr < end) && ((*ptr == '+') || (*ptr == '-'))) {
+			eneg = (*ptr == '-');
+			++ptr;
+		}
+		while ((ptr < end) && isdigit(*ptr)) {
+			if (e < MAXEXPONENT) e = e * 10 + (*ptr - '0');
+			++ptr;
+		}
+		exp10 += eneg ? -e : e;
+	}
+
+	number->type = JSNUMBER_REAL;
+	number->integer = 0;
+
+	if (!truncated && (mantissa <= MAXEXACT) && (exp10 >= -MAXPOWER) && (exp10 <= MAXPOWER)) {
+		double r = (double)mantissa;
+		if (exp10 < 0) r /= Powers[-exp10];
+		else r *= Powers[exp10];
+		number->real = neg ? -r : r;
+	} else {
+		number->real = SlowParse(text,length);
+	}
+}
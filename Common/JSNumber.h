@@ -0,0 +1,62 @@
+//
+//  JSNumber.h
+//  AnalyzeJSON
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#ifndef __AnalyzeJSON__JSNumber__
+#define __AnalyzeJSON__JSNumber__
+
+#include <stdint.h>
+#include <stddef.h>
+
+/************************************************************************/
+/*																		*/
+/*	Numbers																*/
+/*																		*/
+/************************************************************************/
+
+/*
+ *	Number types. A number is an integer if it was written without a
+ *	fraction or exponent; integers are kept exactly if they fit in 64 bits
+ */
+
+#define JSNUMBER_INTEGER	1		/* Integer which fits in int64_t */
+#define JSNUMBER_UNSIGNED	2		/* Integer which only fits in uint64_t */
+#define JSNUMBER_BIGINTEGER	3		/* Integer too large for 64 bits */
+#define JSNUMBER_REAL		4
+
+/*	JSNumber
+ *
+ *		The value of a numeric token. real always holds the nearest double,
+ *	whatever the type; integer or uinteger holds the exact value where the
+ *	type says so. Big integers are only held approximately, so keep the
+ *	text if the exact value matters.
+ */
+
+struct JSNumber
+{
+	int32_t		type;
+	union {
+		int64_t	integer;
+		uint64_t uinteger;
+	};
+	double		real;
+
+	bool		isInteger() const
+					{
+						return type != JSNUMBER_REAL;
+					}
+};
+
+/*	JSParseNumber
+ *
+ *		Parse the text of a JSON number, as returned by JSLex as a
+ *	SYMBOL_INTEGER or SYMBOL_REAL token
+ */
+
+extern void JSParseNumber(const char *text, size_t length, JSNumber *number);
+
+#endif /* defined(__AnalyzeJSON__JSNumber__) */
@@ -0,0 +1,141 @@
+//
+//  JSReadAheadInputStream.cpp
+//  AnalyzeJSON
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#include "JSInputStream.h"
+#include <errno.h>
+#include <unistd.h>
+#include <sys/select.h>
+
+/************************************************************************/
+/*																		*/
+/*	Construction/Destruction											*/
+/*																		*/
+/************************************************************************/
+
+/*	JSReadAheadInputStream::JSReadAheadInputStream
+ *
+ *		Construct me with the file, and start reading. This will take
+ *	ownership of the file and close it when the stream is done
+ */
+
+JSReadAheadInputStream::JSReadAheadInputStream(FILE *f)
+{
+	file = f;
+	if (0 != pipe(wake)) wake[0] = wake[1] = -1;
+	start();
+}
+
+/*	JSReadAheadInputStream::~JSReadAheadInputStream
+ *
+ *		Destroy me
+ */
+
+JSReadAheadInputStream::~JSReadAheadInputStream()
+{
+	finish();
+	if (wake[0] >= 0) {
+		close(wake[0]);
+		close(wake[1]);
+	}
+	fclose(file);
+}
+
+/*	JSReadAheadInputStream::cancel
+ *
+ *		Stop, waking the thread if it is waiting for input
+ */
+
+void JSReadAheadInputStream::cancel()
+{
+	JSThreadInputStream::cancel();
+
+	if (wake[1] >= 0) {
+		char ch = 0;
+		while ((write(wake[1],&ch,1) < 0) && (errno == EINTR)) ;
+	}
+}
+
+/************************************************************************/
+/*																		*/
+/*	Reader																*/
+/*																		*/
+/************************************************************************/
+
+/*	JSReadAheadInputStream::waitInput
+ *
+ *		Wait until there is input to read, or if block is false just look.
+ *	Returns 1 if there is input, 0 if there is none yet, or -1 if we have
+ *	been cancelled
+ */
+
+int JSReadAheadInputStream::waitInput(bool block)
+{
+	int fd = fileno(file);
+	if ((wake[0] < 0) || (fd >= FD_SETSIZE) || (wake[0] >= FD_SETSIZE)) {
+		return 1;							/* Can't wait: just read */
+	}
+
+	for (;;) {
+		fd_set fds;
+		FD_ZERO(&fds);
+		FD_SET(fd,&fds);
+		FD_SET(wake[0],&fds);
+
+		struct timeval now = { 0, 0 };
+		int ret = select(((fd > wake[0]) ? fd : wake[0]) + 1,&fds,NULL,NULL,block ? NULL : &now);
+		if (ret < 0) {
+			if (errno == EINTR) continue;
+			return 1;						/* Let read() report it */
+		}
+
+		if (FD_ISSET(wake[0],&fds)) return -1;
+		return FD_ISSET(fd,&fds) ? 1 : 0;
+	}
+}
+
+/*	JSReadAheadInputStream::produce
+ *
+ *		Thread entry point. A block is handed over once it is full, or once
+ *	no more input is waiting to be read. The first block waits for enough
+ *	bytes to tell if the input is compressed
+ */
+
+void JSReadAheadInputStream::produce()
+{
+	int fd = fileno(file);
+	bool first = true;
+
+	for (;;) {
+		uint8_t *block = nextBlock();
+		if (block == NULL) return;
+
+		size_t len = 0;
+		bool end = false;
+
+		while ((len < THREADBLOCKSIZE) && !end) {
+			bool wait = (len == 0) || (first && (len < 4));
+			int ready = waitInput(wait);
+			if (ready < 0) return;
+			if (ready == 0) break;
+
+			ssize_t r = read(fd,block + len,THREADBLOCKSIZE - len);
+			if (r > 0) {
+				len += (size_t)r;
+			} else if (r == 0) {
+				end = true;
+			} else if (errno != EINTR) {
+				error = "Unable to read the input";
+				end = true;
+			}
+		}
+
+		first = false;
+		putBlock(len);
+		if (end) return;
+	}
+}
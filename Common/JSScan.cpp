@@ -0,0 +1,226 @@
+//
+//  JSScan.cpp
+//  AnalyzeJSON
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#include "JSScan.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define JSSCAN_X86		1
+#include <immintrin.h>
+#endif
+
+/************************************************************************/
+/*																		*/
+/*	Scalar Scanners														*/
+/*																		*/
+/************************************************************************/
+
+static inline bool IsSpace(uint8_t ch)
+{
+	return (ch == ' ') || ((ch >= '\t') && (ch <= '\r'));
+}
+
+static const uint8_t *ScalarSkipWhitespace(const uint8_t *ptr, const uint8_t *end, int32_t *lines)
+{
+	int32_t n = 0;
+
+	while ((ptr < end) && IsSpace(*ptr)) {
+		if (*ptr == '\n') ++n;
+		++ptr;
+	}
+
+	*lines += n;
+	return ptr;
+}
+
+static const uint8_t *ScalarScanString(const uint8_t *ptr, const uint8_t *end)
+{
+	while ((ptr < end) && (*ptr != '"') && (*ptr != '\\') && (*ptr >= 0x20)) ++ptr;
+	return ptr;
+}
+
+#ifdef JSSCAN_X86
+
+/************************************************************************/
+/*																		*/
+/*	SSE2 Scanners														*/
+/*																		*/
+/************************************************************************/
+
+/*
+ *	For both widths a byte is white space if it is ' ' or if (ch - '\t')
+ *	is at most 4 unsigned; we test the latter with an unsigned min. A byte
+ *	is a control character if max(ch,0x1F) is 0x1F.
+ */
+
+static const uint8_t *SSE2SkipWhitespace(const uint8_t *ptr, const uint8_t *end, int32_t *lines)
+{
+	const __m128i space = _mm_set1_epi8(' ');
+	const __m128i tab = _mm_set1_epi8('\t');
+	const __m128i four = _mm_set1_epi8(4);
+	const __m128i nl = _mm_set1_epi8('\n');
+	int32_t n = 0;
+
+	while (end - ptr >= 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *)ptr);
+		__m128i t = _mm_sub_epi8(v,tab);
+		__m128i ws = _mm_or_si128(_mm_cmpeq_epi8(v,space),_mm_cmpeq_epi8(_mm_min_epu8(t,four),t));
+
+		uint32_t notws = ~(uint32_t)_mm_movemask_epi8(ws) & 0xFFFF;
+		uint32_t newline = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v,nl));
+
+		if (notws) {
+			uint32_t index = __builtin_ctz(notws);
+			n += __builtin_popcount(newline & ((1U << index) - 1));
+			*lines += n;
+			return ptr + index;
+		}
+
+		n += __builtin_popcount(newline);
+		ptr += 16;
+	}
+
+	*lines += n;
+	return ScalarSkipWhitespace(ptr,end,lines);
+}
+
+static const uint8_t *SSE2ScanString(const uint8_t *ptr, const uint8_t *end)
+{
+	const __m128i quote = _mm_set1_epi8('"');
+	const __m128i slash = _mm_set1_epi8('\\');
+	const __m128i ctrl = _mm_set1_epi8(0x1F);
+
+	while (end - ptr >= 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *)ptr);
+		__m128i m = _mm_or_si128(_mm_cmpeq_epi8(v,quote),_mm_cmpeq_epi8(v,slash));
+		m = _mm_or_si128(m,_mm_cmpeq_epi8(_mm_max_epu8(v,ctrl),ctrl));
+
+		uint32_t mask = (uint32_t)_mm_movemask_epi8(m);
+		if (mask) return ptr + __builtin_ctz(mask);
+		ptr += 16;
+	}
+
+	return ScalarScanString(ptr,end);
+}
+
+/************************************************************************/
+/*																		*/
+/*	AVX2 Scanners														*/
+/*																		*/
+/************************************************************************/
+
+__attribute__((target("avx2")))
+static const uint8_t *AVX2SkipWhitespace(const uint8_t *ptr, const uint8_t *end, int32_t *lines)
+{
+	const __m256i space = _mm256_set1_epi8(' ');
+	const __m256i tab = _mm256_set1_epi8('\t');
+	const __m256i four = _mm256_set1_epi8(4);
+	const __m256i nl = _mm256_set1_epi8('\n');
+	int32_t n = 0;
+
+	while (end - ptr >= 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i *)ptr);
+		__m256i t = _mm256_sub_epi8(v,tab);
+		__m256i ws = _mm256_or_si256(_mm256_cmpeq_epi8(v,space),_mm256_cmpeq_epi8(_mm256_min_epu8(t,four),t));
+
+		uint32_t notws = ~(uint32_t)_mm256_movemask_epi8(ws);
+		uint32_t newline = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v,nl));
+
+		if (notws) {
+			uint32_t index = __builtin_ctz(notws);
+			n += __builtin_popcount(newline & ((1U << index) - 1));
+			*lines += n;
+			return ptr + index;
+		}
+
+		n += __builtin_popcount(newline);
+		ptr += 32;
+	}
+
+	*lines += n;
+	return SSE2SkipWhitespace(ptr,end,lines);
+}
+
+__attribute__((target("avx2")))
+static const uint8_t *AVX2ScanString(const uint8_t *ptr, const uint8_t *end)
+{
+	const __m256i quote = _mm256_set1_epi8('"');
+	const __m256i slash = _mm256_set1_epi8('\\');
+	const __m256i ctrl = _mm256_set1_epi8(0x1F);
+
+	while (end - ptr >= 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i *)ptr);
+		__m256i m = _mm256_or_si256(_mm256_cmpeq_epi8(v,quote),_mm256_cmpeq_epi8(v,slash));
+		m = _mm256_or_si256(m,_mm256_cmpeq_epi8(_mm256_max_epu8(v,ctrl),ctrl));
+
+		uint32_t mask = (uint32_t)_mm256_movemask_epi8(m);
+		if (mask) return ptr + __builtin_ctz(mask);
+		ptr += 32;
+	}
+
+	return SSE2ScanString(ptr,end);
+}
+
+#endif
+
+/************************************************************************/
+/*																		*/
+/*	Dispatch															*/
+/*																		*/
+/************************************************************************/
+
+typedef const uint8_t *(*SkipWhitespaceProc)(const uint8_t *, const uint8_t *, int32_t *);
+typedef const uint8_t *(*ScanStringProc)(const uint8_t *, const uint8_t *);
+
+/*
+ *	Pick the widest scanners the processor supports. These run once, the
+ *	first time each scanner is called
+ */
+
+#ifdef JSSCAN_X86
+static int ScanWidth()
+{
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) return 32;
+	if (__builtin_cpu_supports("sse2")) return 16;
+	return 1;
+}
+#endif
+
+static SkipWhitespaceProc SelectSkipWhitespace()
+{
+#ifdef JSSCAN_X86
+	switch (ScanWidth()) {
+		case 32:	return AVX2SkipWhitespace;
+		case 16:	return SSE2SkipWhitespace;
+	}
+#endif
+	return ScalarSkipWhitespace;
+}
+
+static ScanStringProc SelectScanString()
+{
+#ifdef JSSCAN_X86
+	switch (ScanWidth()) {
+		case 32:	return AVX2ScanString;
+		case 16:	return SSE2ScanString;
+	}
+#endif
+	return ScalarScanString;
+}
+
+const uint8_t *JSSkipWhitespace(const uint8_t *ptr, const uint8_t *end, int32_t *lines)
+{
+	static SkipWhitespaceProc proc = SelectSkipWhitespace();
+	return (*proc)(ptr,end,lines);
+}
+
+const uint8_t *JSScanString(const uint8_t *ptr, const uint8_t *end)
+{
+	static ScanStringProc proc = SelectScanString();
+	return (*proc)(ptr,end);
+}
@@ -0,0 +1,45 @@
+//
+//  JSScan.h
+//  AnalyzeJSON
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#ifndef AnalyzeJSON_JSScan_h
+#define AnalyzeJSON_JSScan_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+/************************************************************************/
+/*																		*/
+/*	Block Scanning														*/
+/*																		*/
+/************************************************************************/
+
+/*
+ *	Scanners used by the lexer to run over a block of text several bytes
+ *	at a time. On x86 these use SSE2 or AVX2, selected when first called
+ *	based on what the processor supports; elsewhere they fall back to a
+ *	simple loop.
+ */
+
+/*	JSSkipWhitespace
+ *
+ *		Return the first character in [ptr,end) which is not white space
+ *	(as defined by isspace() in the C locale), or end. The number of '\n'
+ *	characters skipped over is added to *lines.
+ */
+
+extern const uint8_t *JSSkipWhitespace(const uint8_t *ptr, const uint8_t *end, int32_t *lines);
+
+/*	JSScanString
+ *
+ *		Return the first '"', '\\' or control character in [ptr,end), or
+ *	end. Everything before that can be copied into a string token as is.
+ */
+
+extern const uint8_t *JSScanString(const uint8_t *ptr, const uint8_t *end);
+
+#endif
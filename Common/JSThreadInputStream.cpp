@@ -0,0 +1,188 @@
+//
+//  JSThreadInputStream.cpp
+//  AnalyzeJSON
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 agent. All rights reserved.
+//
+
+#include "JSInputStream.h"
+
+/************************************************************************/
+/*																		*/
+/*	Construction/Destruction											*/
+/*																		*/
+/************************************************************************/
+
+/*	JSThreadInputStream::JSThreadInputStream
+ *
+ *		Construct me. The thread is not started until the subclass is
+ *	ready for it
+ */
+
+JSThreadInputStream::JSThreadInputStream()
+{
+	for (int i = 0; i < THREADBLOCKS; ++i) {
+		blocks[i] = new uint8_t[THREADBLOCKSIZE];
+		lengths[i] = 0;
+	}
+	head = 0;
+	tail = 0;
+	done = false;
+	stop = false;
+
+	data = NULL;
+	pos = 0;
+	length = 0;
+	holding = false;
+}
+
+/*	JSThreadInputStream::~JSThreadInputStream
+ *
+ *		Destroy me
+ */
+
+JSThreadInputStream::~JSThreadInputStream()
+{
+	finish();
+
+	for (int i = 0; i < THREADBLOCKS; ++i) {
+		delete[] blocks[i];
+	}
+}
+
+/*	JSThreadInputStream::start
+ *
+ *		Start the thread
+ */
+
+void JSThreadInputStream::start()
+{
+	thread = std::thread(&JSThreadInputStream::run,this);
+}
+
+/*	JSThreadInputStream::finish
+ *
+ *		Stop the thread, which may be waiting for a free block, and wait
+ *	for it to end
+ */
+
+void JSThreadInputStream::finish()
+{
+	if (!thread.joinable()) return;
+
+	cancel();
+	thread.join();
+}
+
+/*	JSThreadInputStream::cancel
+ *
+ *		Tell the thread to stop filling blocks. Anything still waiting on
+ *	us for data is told the stream has ended
+ */
+
+void JSThreadInputStream::cancel()
+{
+	std::lock_guard<std::mutex> guard(lock);
+	stop = true;
+	changed.notify_all();
+}
+
+/************************************************************************/
+/*																		*/
+/*	Reader																*/
+/*																		*/
+/************************************************************************/
+
+/*	JSThreadInputStream::peekBlock
+ *
+ *		Return the rest of the current block. Once it is used up, it goes
+ *	back to the thread and we wait for the next one
+ */
+
+size_t JSThreadInputStream::peekBlock(const uint8_t **ptr)
+{
+	if (pos < length) {
+		*ptr = data + pos;
+		return length - pos;
+	}
+
+	std::unique_lock<std::mutex> guard(lock);
+	if (holding) {
+		holding = false;
+		++tail;
+		changed.notify_all();
+	}
+
+	while ((tail == head) && !done && !stop) changed.wait(guard);
+	if (tail == head) {
+		if (done && !error.empty()) {
+			fprintf(stderr,"%s\n",error.c_str());
+			error.clear();
+		}
+		length = pos = 0;
+		return 0;
+	}
+
+	data = blocks[tail % THREADBLOCKS];
+	length = lengths[tail % THREADBLOCKS];
+	pos = 0;
+	holding = true;
+
+	*ptr = data;
+	return length;
+}
+
+void JSThreadInputStream::skipBlock(size_t len)
+{
+	pos += len;
+}
+
+/************************************************************************/
+/*																		*/
+/*	Thread																*/
+/*																		*/
+/************************************************************************/
+
+/*	JSThreadInputStream::nextBlock
+ *
+ *		Wait for a free block to fill. Returns NULL if the stream is being
+ *	destroyed
+ */
+
+uint8_t *JSThreadInputStream::nextBlock()
+{
+	std::unique_lock<std::mutex> guard(lock);
+	while ((head - tail >= THREADBLOCKS) && !stop) changed.wait(guard);
+	if (stop) return NULL;
+	return blocks[head % THREADBLOCKS];
+}
+
+/*	JSThreadInputStream::putBlock
+ *
+ *		Hand a filled block to the reader
+ */
+
+void JSThreadInputStream::putBlock(size_t len)
+{
+	if (len == 0) return;
+
+	std::lock_guard<std::mutex> guard(lock);
+	lengths[head % THREADBLOCKS] = len;
+	++head;
+	changed.notify_all();
+}
+
+/*	JSThreadInputStream::run
+ *
+ *		Thread entry point
+ */
+
+void JSThreadInputStream::run()
+{
+	produce();
+
+	std::lock_guard<std::mutex> guard(lock);
+	done = true;
+	changed.notify_all();
+}
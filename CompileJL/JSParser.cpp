@@ -39,7 +39,8 @@ JSParser::JSParser(ref<JSInputStream> is)
 									  "object",
 									  "arrayof",
 									  "optional",
-									  "nullable" };
+									  "nullable",
+									  NULL };
 	lex = new JSLex(is,reserved);
 }
 
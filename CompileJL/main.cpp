@@ -27,7 +27,7 @@ static const char *Prefix;
 
 static void runCompiler(FILE *in, const char *pathOut, int language, bool readOnly)
 {
-	ref<JSInputStream> is = new JSFileInputStream(in);
+	ref<JSInputStream> is = JSOpenInputStream(in);
 	ref<JSParser> parser = new JSParser(is);
 
 	if (!parser->run()) return;